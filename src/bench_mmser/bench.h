@@ -0,0 +1,122 @@
+// SPDX-FileCopyrightText: 2025 Simon Gene Gottlieb
+// SPDX-License-Identifier: CC0-1.0
+#pragma once
+
+#include <mmser/mmser.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace bench {
+
+// command line options shared by all benchmarks
+struct Options {
+    std::vector<size_t> sizes{1, 16, 256};    // payload sizes in MiB
+    std::vector<std::string> shapes;          // empty means all shapes
+    std::vector<size_t> counts{1'000'000};    // number of keys/elements
+    size_t repeat{5};
+    std::filesystem::path dir{std::filesystem::temp_directory_path()};
+
+    bool selected(std::string_view shape) const {
+        return shapes.empty() || std::ranges::find(shapes, shape) != shapes.end();
+    }
+};
+
+inline auto splitList(std::string_view s) -> std::vector<std::string> {
+    auto r = std::vector<std::string>{};
+    while (!s.empty()) {
+        auto p = s.find(',');
+        r.emplace_back(s.substr(0, p));
+        if (p == std::string_view::npos) break;
+        s = s.substr(p+1);
+    }
+    return r;
+}
+
+inline auto parseOptions(int argc, char** args) -> Options {
+    auto opt = Options{};
+    auto toSizes = [](std::string_view s) {
+        auto r = std::vector<size_t>{};
+        for (auto const& e : splitList(s)) {
+            r.push_back(std::stoull(e));
+        }
+        return r;
+    };
+    for (int i{0}; i < argc; ++i) {
+        auto arg = std::string_view{args[i]};
+        if (i+1 == argc) {
+            throw std::runtime_error{"missing value for " + std::string{arg}};
+        }
+        auto value = std::string_view{args[++i]};
+        if (arg == "--sizes") {
+            opt.sizes = toSizes(value);
+        } else if (arg == "--counts") {
+            opt.counts = toSizes(value);
+        } else if (arg == "--shapes") {
+            opt.shapes = splitList(value);
+        } else if (arg == "--repeat") {
+            opt.repeat = std::max<size_t>(1, std::stoull(std::string{value}));
+        } else if (arg == "--dir") {
+            opt.dir = value;
+        } else {
+            throw std::runtime_error{"unknown option " + std::string{arg}};
+        }
+    }
+    return opt;
+}
+
+// Runs `f` `repeat` times, `prepare` is called untimed before each run.
+// Returns the measured durations in seconds, sorted ascending.
+inline auto measure(size_t repeat, std::function<void()> const& prepare, std::function<void()> const& f) -> std::vector<double> {
+    auto r = std::vector<double>{};
+    for (size_t i{0}; i < repeat; ++i) {
+        prepare();
+        auto start = std::chrono::steady_clock::now();
+        f();
+        auto end = std::chrono::steady_clock::now();
+        r.push_back(std::chrono::duration<double>(end - start).count());
+    }
+    std::ranges::sort(r);
+    return r;
+}
+
+inline auto median(std::vector<double> const& v) -> double {
+    return v[v.size()/2];
+}
+
+// Evicts a file from the page cache, so the next access reads from disk
+inline void dropPageCache(std::filesystem::path const& path) {
+#ifdef MMSER_MMAP
+    auto fd = ::open(path.c_str(), O_RDONLY);
+    if (fd == -1) return;
+    ::fsync(fd);
+    #ifdef POSIX_FADV_DONTNEED
+        ::posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+    #endif
+    ::close(fd);
+#else
+    (void)path;
+#endif
+}
+
+// Prevents the compiler from removing computations whose result is unused
+template <typename T>
+void doNotOptimize(T const& value) {
+#if defined(__GNUC__)
+    asm volatile("" : : "r,m"(value) : "memory");
+#else
+    static volatile T sink;
+    sink = value;
+#endif
+}
+
+inline void printHeader(std::string_view columns) {
+    std::printf("%s\n", std::string{columns}.c_str());
+}
+
+}
@@ -0,0 +1,62 @@
+// SPDX-FileCopyrightText: 2025 Simon Gene Gottlieb
+// SPDX-License-Identifier: CC0-1.0
+#pragma once
+
+#include "bench.h"
+
+namespace bench {
+
+// Random rank1/select1 queries on a mapped bitvector, against scanning the
+// words from the beginning.
+inline int benchBitvector(Options const& opt) {
+    std::printf("%-22s %12s %12s\n", "query", "bits", "time[ns]");
+    for (auto count : opt.counts) {
+        auto bv = mmser::bitvector{};
+        for (size_t i{0}; i < count; ++i) {
+            bv.push_back(mmser::mix64(i) % 2);
+        }
+        bv.buildIndex();
+        auto path = opt.dir / "bench_mmser_bitvector.idx";
+        mmser::saveFile(path, bv);
+        auto [loaded, storage] = mmser::loadFile<mmser::bitvector>(path);
+        auto const ones = loaded.rank1(count);
+        if (ones == 0) continue;
+
+        auto report = [&](char const* name, size_t queryCount, auto query) {
+            auto times = measure(opt.repeat, []() {}, [&]() {
+                uint64_t total{};
+                for (size_t i{0}; i < queryCount; ++i) {
+                    total += query(mmser::mix64(i + count));
+                }
+                doNotOptimize(total);
+            });
+            std::printf("%-22s %12zu %12.1f\n", name, count, median(times) * 1e9 / static_cast<double>(queryCount));
+        };
+
+        auto naiveRank = [&](size_t i) -> size_t {
+            size_t r{};
+            for (size_t w{0}; w < i / 64; ++w) {
+                r += std::popcount(loaded.bits.view[w]);
+            }
+            return r + std::popcount(loaded.bits.view[i / 64] & ((uint64_t{1} << (i % 64)) - 1));
+        };
+        auto naiveSelect = [&](size_t k) -> size_t {
+            for (size_t w{0}; ; ++w) {
+                auto c = static_cast<size_t>(std::popcount(loaded.bits.view[w]));
+                if (k < c) return w * 64 + mmser::selectInWord(loaded.bits.view[w], k);
+                k -= c;
+            }
+        };
+        // the naive scans are linear, fewer queries keep their runtime in check
+        auto const queries      = size_t{1'000'000};
+        auto const naiveQueries = std::max<size_t>(1, std::min<size_t>(queries, (size_t{1} << 32) / (count / 64 + 1)));
+        report("rank1",        queries,      [&](uint64_t r) { return loaded.rank1(r % count); });
+        report("rank1 (scan)", naiveQueries, [&](uint64_t r) { return naiveRank(r % count); });
+        report("select1",        queries,      [&](uint64_t r) { return loaded.select1(r % ones); });
+        report("select1 (scan)", naiveQueries, [&](uint64_t r) { return naiveSelect(r % ones); });
+        std::filesystem::remove(path);
+    }
+    return 0;
+}
+
+}
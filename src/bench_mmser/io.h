@@ -0,0 +1,166 @@
+// SPDX-FileCopyrightText: 2025 Simon Gene Gottlieb
+// SPDX-License-Identifier: CC0-1.0
+#pragma once
+
+#include "bench.h"
+
+#include <numeric>
+
+namespace bench {
+
+// Data shapes, each generated such that its payload is roughly `bytes` large
+struct BigVector {
+    using type = mmser::vector<uint64_t>;
+    static constexpr char const* name = "vector";
+
+    static auto generate(size_t bytes) -> type {
+        auto r = type{};
+        r.resize(bytes / sizeof(uint64_t));
+        for (size_t i{0}; i < r.size(); ++i) {
+            r[i] = i * 7;
+        }
+        return r;
+    }
+    static auto scan(type const& t) -> uint64_t {
+        uint64_t total{};
+        for (size_t i{0}; i < t.size(); ++i) {
+            total += t[i];
+        }
+        return total;
+    }
+};
+
+struct SmallVectors {
+    using type = std::vector<mmser::vector<uint32_t>>;
+    static constexpr char const* name = "small_vectors";
+
+    static auto generate(size_t bytes) -> type {
+        auto r = type{};
+        r.resize(bytes / (16 * sizeof(uint32_t)));
+        for (size_t i{0}; i < r.size(); ++i) {
+            r[i].resize(16, i);
+        }
+        return r;
+    }
+    static auto scan(type const& t) -> uint64_t {
+        uint64_t total{};
+        for (auto const& v : t) {
+            for (size_t i{0}; i < v.size(); ++i) {
+                total += v[i];
+            }
+        }
+        return total;
+    }
+};
+
+struct Strings {
+    using type = std::vector<std::string>;
+    static constexpr char const* name = "strings";
+
+    static auto generate(size_t bytes) -> type {
+        auto r = type{};
+        r.resize(bytes / 24);
+        for (size_t i{0}; i < r.size(); ++i) {
+            r[i] = "entry_" + std::to_string(i * 7919);
+        }
+        return r;
+    }
+    static auto scan(type const& t) -> uint64_t {
+        uint64_t total{};
+        for (auto const& s : t) {
+            total += s.size() + static_cast<unsigned char>(s.back());
+        }
+        return total;
+    }
+};
+
+template <typename Shape>
+void benchShape(Options const& opt, size_t sizeMiB) {
+    using T = typename Shape::type;
+    auto const bytes = sizeMiB * 1024 * 1024;
+    auto const path = opt.dir / ("bench_mmser_" + std::string{Shape::name} + ".idx");
+
+    auto report = [&](char const* method, char const* cache, std::vector<double> const& load, std::vector<double> const& scan) {
+        auto fileSize = static_cast<double>(std::filesystem::file_size(path));
+        auto mibs = [&](double t) { return fileSize / (1024. * 1024.) / t; };
+        std::printf("%-14s %8zu %-16s %-5s %10.4f %10.4f %10.4f %10.4f %10.1f %10.1f\n",
+            Shape::name, sizeMiB, method, cache,
+            load.front(), median(load), load.back(), median(scan),
+            mibs(median(load)), mibs(median(load) + median(scan)));
+    };
+
+    auto pool = mmser::ThreadPool{};
+    auto const input = Shape::generate(bytes);
+    auto const expected = Shape::scan(input);
+
+    auto benchSave = [&](char const* method, auto save) {
+        auto times = measure(opt.repeat, [&]() {
+            std::filesystem::remove(path);
+        }, [&]() {
+            save(path, input);
+        });
+        report(method, "-", times, {0.});
+    };
+    benchSave("saveFileCopy",   [](auto const& p, auto const& t) { mmser::saveFileCopy(p, t); });
+    benchSave("saveFileStream", [](auto const& p, auto const& t) { mmser::saveFileStream(p, t); });
+#ifdef MMSER_MMAP
+    benchSave("saveFileMMap",   [](auto const& p, auto const& t) { mmser::saveFileMMap(p, t); });
+    benchSave("saveFileMMap(p)", [&](auto const& p, auto const& t) { mmser::saveFileMMap(p, t, pool); });
+    benchSave("saveFileGrowing", [](auto const& p, auto const& t) { mmser::saveFileGrowing(p, t); });
+    benchSave("saveFileGather",  [](auto const& p, auto const& t) { mmser::saveFileGather(p, t); });
+#endif
+
+    mmser::saveFile(path, input);
+
+    auto benchLoad = [&](char const* method, auto load) {
+        for (auto cold : {true, false}) {
+            auto loadTimes = std::vector<double>{};
+            auto scanTimes = std::vector<double>{};
+            for (size_t i{0}; i < opt.repeat; ++i) {
+                if (cold) {
+                    dropPageCache(path);
+                } else {
+                    auto [warmup, storage] = load(path);
+                    doNotOptimize(Shape::scan(warmup));
+                }
+                auto start = std::chrono::steady_clock::now();
+                auto [output, storage] = load(path);
+                auto mid = std::chrono::steady_clock::now();
+                auto result = Shape::scan(output);
+                auto end = std::chrono::steady_clock::now();
+                if (result != expected) {
+                    throw std::runtime_error{std::string{"wrong result for "} + method};
+                }
+                loadTimes.push_back(std::chrono::duration<double>(mid - start).count());
+                scanTimes.push_back(std::chrono::duration<double>(end - mid).count());
+            }
+            std::ranges::sort(loadTimes);
+            std::ranges::sort(scanTimes);
+            report(method, cold ? "cold" : "warm", loadTimes, scanTimes);
+        }
+    };
+    benchLoad("loadFileCopy",   [](auto const& p) { return mmser::loadFileCopy<T>(p); });
+    benchLoad("loadFileCopy(p)", [&](auto const& p) { return mmser::loadFileCopy<T>(p, pool); });
+    benchLoad("loadFileStream", [](auto const& p) { return mmser::loadFileStream<T>(p); });
+#ifdef MMSER_MMAP
+    benchLoad("loadFileMMap",   [](auto const& p) { return mmser::loadFileMMap<T>(p); });
+#endif
+
+    std::filesystem::remove(path);
+}
+
+// Compares all load and save paths for different shapes and payload sizes.
+// Load times are split into the load call itself and a first scan over all
+// data; mmap based loads defer most of their work into the scan.
+inline int benchIO(Options const& opt) {
+    std::printf("%-14s %8s %-16s %-5s %10s %10s %10s %10s %10s %10s\n",
+        "shape", "MiB", "method", "cache", "min[s]", "median[s]", "max[s]", "scan[s]", "MiB/s", "MiB/s+scan");
+    for (auto size : opt.sizes) {
+        if (opt.selected(BigVector::name))    benchShape<BigVector>(opt, size);
+        if (opt.selected(SmallVectors::name)) benchShape<SmallVectors>(opt, size);
+        if (opt.selected(Strings::name))      benchShape<Strings>(opt, size);
+    }
+    return 0;
+}
+
+}
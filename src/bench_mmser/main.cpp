@@ -0,0 +1,49 @@
+// SPDX-FileCopyrightText: 2025 Simon Gene Gottlieb
+// SPDX-License-Identifier: CC0-1.0
+#include "bench.h"
+#include "bitvector.h"
+#include "io.h"
+#include "perfect_hash.h"
+#include "search.h"
+
+#include <iostream>
+
+namespace {
+void printUsage() {
+    std::cout << "usage: bench_mmser <benchmark> [options]\n"
+                 "benchmarks:\n"
+                 "  bitvector       rank/select against scanning the bits\n"
+                 "  io              compares all load*/save* paths\n"
+                 "  phf             perfect_hash against std::unordered_map\n"
+                 "  search          static_search_tree against std::lower_bound\n"
+                 "options:\n"
+                 "  --sizes 1,16    payload sizes in MiB\n"
+                 "  --shapes a,b    shapes to run (vector, small_vectors, strings)\n"
+                 "  --counts 1000   number of elements/keys\n"
+                 "  --repeat 5      repetitions per measurement\n"
+                 "  --dir /tmp      directory for temporary files\n";
+}
+}
+
+int main(int argc, char** args) {
+    if (argc < 2) {
+        printUsage();
+        return 1;
+    }
+    auto const opt = bench::parseOptions(argc-2, args+2);
+
+    if (std::string{"bitvector"} == args[1]) {
+        return bench::benchBitvector(opt);
+    }
+    if (std::string{"io"} == args[1]) {
+        return bench::benchIO(opt);
+    }
+    if (std::string{"phf"} == args[1]) {
+        return bench::benchPerfectHash(opt);
+    }
+    if (std::string{"search"} == args[1]) {
+        return bench::benchSearch(opt);
+    }
+    printUsage();
+    return 1;
+}
@@ -0,0 +1,80 @@
+// SPDX-FileCopyrightText: 2025 Simon Gene Gottlieb
+// SPDX-License-Identifier: CC0-1.0
+#pragma once
+
+#include "bench.h"
+
+#include <unordered_map>
+
+namespace bench {
+
+// perfect hash function plus values, as it would be stored in a file
+struct PerfectHashIndex {
+    mmser::perfect_hash<uint64_t> ph;
+    mmser::vector<uint32_t> values;
+
+    template <typename Ar>
+    void serialize(this auto&& self, Ar& ar) {
+        ar(self.ph, self.values);
+    }
+};
+
+// Random lookups of existing keys, perfect_hash (loaded via mmap) against
+// std::unordered_map.
+inline int benchPerfectHash(Options const& opt) {
+    std::printf("%-22s %12s %10s %12s %10s\n", "structure", "keys", "build[s]", "lookup[ns]", "bits/key");
+    for (auto count : opt.counts) {
+        auto keys = std::vector<uint64_t>(count);
+        for (size_t i{0}; i < count; ++i) {
+            keys[i] = mmser::mix64(i + 1);
+        }
+        auto queries = std::vector<uint64_t>(std::min<size_t>(count, 10'000'000));
+        for (size_t i{0}; i < queries.size(); ++i) {
+            queries[i] = keys[mmser::mulhi64(mmser::mix64(i + count), count)];
+        }
+
+        auto report = [&](char const* name, double build, auto lookup, double bitsPerKey) {
+            auto times = measure(opt.repeat, []() {}, [&]() {
+                uint64_t total{};
+                for (auto q : queries) {
+                    total += lookup(q);
+                }
+                doNotOptimize(total);
+            });
+            std::printf("%-22s %12zu %10.3f %12.1f %10.2f\n", name, count, build,
+                median(times) * 1e9 / static_cast<double>(queries.size()), bitsPerKey);
+        };
+
+        {
+            auto start = std::chrono::steady_clock::now();
+            auto map = std::unordered_map<uint64_t, uint32_t>{};
+            map.reserve(count);
+            for (size_t i{0}; i < count; ++i) {
+                map.emplace(keys[i], static_cast<uint32_t>(i));
+            }
+            auto build = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            report("std::unordered_map", build, [&](uint64_t q) { return map.find(q)->second; }, 0.);
+        }
+
+        auto path = opt.dir / "bench_mmser_perfect_hash.idx";
+        {
+            auto start = std::chrono::steady_clock::now();
+            auto index = PerfectHashIndex{};
+            index.ph = mmser::perfect_hash<uint64_t>{keys};
+            index.values = mmser::vector<uint32_t>(count);
+            for (size_t i{0}; i < count; ++i) {
+                index.values[index.ph(keys[i])] = static_cast<uint32_t>(i);
+            }
+            auto build = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            mmser::saveFile(path, index);
+            auto functionBytes = mmser::computeSaveSize(index.ph);
+            auto [loaded, storage] = mmser::loadFile<PerfectHashIndex>(path);
+            report("mmser::perfect_hash", build, [&](uint64_t q) { return loaded.values[loaded.ph(q)]; },
+                8. * static_cast<double>(functionBytes) / static_cast<double>(count));
+        }
+        std::filesystem::remove(path);
+    }
+    return 0;
+}
+
+}
@@ -0,0 +1,64 @@
+// SPDX-FileCopyrightText: 2025 Simon Gene Gottlieb
+// SPDX-License-Identifier: CC0-1.0
+#pragma once
+
+#include "bench.h"
+
+namespace bench {
+
+// sorted keys and their search tree, as they would be stored in a file
+struct SearchIndex {
+    mmser::vector<uint64_t> sorted;
+    mmser::static_search_tree<uint64_t> tree;
+
+    template <typename Ar>
+    void serialize(this auto&& self, Ar& ar) {
+        ar(self.sorted, self.tree);
+    }
+};
+
+// Random lower_bound queries on a mapped file, std::lower_bound over the
+// sorted array against static_search_tree.
+inline int benchSearch(Options const& opt) {
+    std::printf("%-28s %12s %12s\n", "structure", "keys", "lookup[ns]");
+    for (auto count : opt.counts) {
+        auto index = SearchIndex{};
+        index.sorted.resize(count);
+        for (size_t i{0}; i < count; ++i) {
+            index.sorted[i] = mmser::mix64(i);
+        }
+        std::ranges::sort(index.sorted.owningBuffer);
+        index.tree = mmser::static_search_tree<uint64_t>{index.sorted.view};
+
+        auto queries = std::vector<uint64_t>(std::min<size_t>(count, 10'000'000));
+        for (size_t i{0}; i < queries.size(); ++i) {
+            queries[i] = mmser::mix64(i + count);
+        }
+
+        auto path = opt.dir / "bench_mmser_search.idx";
+        mmser::saveFile(path, index);
+        auto [loaded, storage] = mmser::loadFile<SearchIndex>(path);
+
+        auto report = [&](char const* name, auto lookup) {
+            auto times = measure(opt.repeat, []() {}, [&]() {
+                uint64_t total{};
+                for (auto q : queries) {
+                    total += lookup(q);
+                }
+                doNotOptimize(total);
+            });
+            std::printf("%-28s %12zu %12.1f\n", name, count,
+                median(times) * 1e9 / static_cast<double>(queries.size()));
+        };
+        report("std::lower_bound", [&](uint64_t q) -> size_t {
+            return std::lower_bound(loaded.sorted.view.begin(), loaded.sorted.view.end(), q) - loaded.sorted.view.begin();
+        });
+        report("mmser::static_search_tree", [&](uint64_t q) -> size_t {
+            return loaded.tree.lower_bound(q);
+        });
+        std::filesystem::remove(path);
+    }
+    return 0;
+}
+
+}
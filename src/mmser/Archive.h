@@ -3,10 +3,13 @@
 #pragma once
 
 #include "Mode.h"
+#include "copy.h"
 
 #include <cassert>
 #include <filesystem>
 #include <span>
+#include <stdexcept>
+#include <string>
 #include <type_traits>
 
 namespace mmser {
@@ -20,15 +23,31 @@ concept is_mmser = is_mmser_t<T>::value;
 template <Mode _mode>
 struct Archive;
 
-auto requiredPaddingBytes(size_t totalSize, size_t alignment) -> size_t;
+constexpr auto requiredPaddingBytes(size_t totalSize, size_t alignment) -> size_t {
+    size_t usedBytesOfNextElement = totalSize % alignment;
+    if (usedBytesOfNextElement == 0) return 0;
+    return alignment - usedBytesOfNextElement;
+}
+
 template <typename Ar, typename T>
 void handle(Ar& ar, T& t);
 
+// Loading archives check every read against the end of the buffer: a
+// damaged file, or a file that was appended to (see appendFile) after it
+// was mapped, may announce more bytes than the buffer holds
+inline void checkAvailable(size_t required, size_t available) {
+    if (required > available) {
+        throw std::runtime_error{"archive is truncated, " + std::to_string(required) + " bytes required, but only "
+                                 + std::to_string(available) + " bytes available"};
+    }
+}
+
 template <Mode _mode>
 struct ArchiveBase {
     static constexpr Mode mode = _mode;
     static constexpr bool loading() { return mode == Mode::Load; }
-    static constexpr bool loadingMMap() { return mode == Mode::LoadMMap; }
+    static constexpr bool loadingMMap() { return mode == Mode::LoadMMap || mode == Mode::LoadMMapWritable; }
+    static constexpr bool loadingMMapWritable() { return mode == Mode::LoadMMapWritable; }
     static constexpr bool saving() { return mode == Mode::Save; }
 
     template <typename Self, typename T>
@@ -39,6 +58,16 @@ struct ArchiveBase {
     void operator()(this Self&& self, Args&&... args) {
         (handle(std::forward<Self>(self), std::forward<Args>(args)), ...);
     }
+
+    // Loads a payload written by saveMMap into storage of the caller:
+    // alloc(size) receives the stored size and returns the std::span<char>
+    // the payload is read into, without an intermediate copy
+    template <typename Self, typename Alloc>
+    void loadInto(this Self&& self, size_t alignment, Alloc&& alloc) {
+        size_t size{};
+        self & size;
+        self.load(alloc(size), alignment);
+    }
 };
 
 template <Mode _mode>
@@ -53,13 +82,11 @@ struct Archive<Mode::Load> : ArchiveBase<Mode::Load> {
 
     void load(std::span<char> _in, size_t alignment = 1) {
         auto paddingBytes = requiredPaddingBytes(totalSize, alignment);
-        assert(paddingBytes <= buffer.size());
+        checkAvailable(paddingBytes, buffer.size());
         buffer = buffer.subspan(paddingBytes);
 
-        assert (_in.size() <= buffer.size());
-        for (size_t i{}; i < _in.size(); ++i) {
-            _in[i] = buffer[i];
-        }
+        checkAvailable(_in.size(), buffer.size());
+        copyBytes(_in.data(), buffer.data(), _in.size());
         buffer = buffer.subspan(_in.size());
         totalSize += _in.size() + paddingBytes;
     }
@@ -69,10 +96,10 @@ struct Archive<Mode::Load> : ArchiveBase<Mode::Load> {
         *this & size;
 
         auto paddingBytes = requiredPaddingBytes(totalSize, alignment);
-        assert(paddingBytes <= buffer.size());
+        checkAvailable(paddingBytes, buffer.size());
         buffer = buffer.subspan(paddingBytes);
 
-        assert(size <= buffer.size());
+        checkAvailable(size, buffer.size());
         auto r = buffer.subspan(0, size);
         buffer = buffer.subspan(size);
         totalSize += size + paddingBytes;
@@ -84,18 +111,17 @@ template <>
 struct Archive<Mode::LoadMMap> : ArchiveBase<Mode::LoadMMap> {
     std::span<char const> buffer;
     size_t totalSize{};
+    bool privateMapping{}; // buffer is a MAP_PRIVATE file mapping, views into it may be made writable
 
     Archive(std::span<char const> _buffer) : buffer{_buffer} {}
 
     void load(std::span<char> _in, size_t alignment = 1) {
         auto paddingBytes = requiredPaddingBytes(totalSize, alignment);
-        assert(paddingBytes <= buffer.size());
+        checkAvailable(paddingBytes, buffer.size());
         buffer = buffer.subspan(paddingBytes);
 
-        assert (_in.size() <= buffer.size());
-        for (size_t i{}; i < _in.size(); ++i) {
-            _in[i] = buffer[i];
-        }
+        checkAvailable(_in.size(), buffer.size());
+        copyBytes(_in.data(), buffer.data(), _in.size());
         buffer = buffer.subspan(_in.size());
         totalSize += _in.size() + paddingBytes;
     }
@@ -105,10 +131,10 @@ struct Archive<Mode::LoadMMap> : ArchiveBase<Mode::LoadMMap> {
         *this & size;
 
         auto paddingBytes = requiredPaddingBytes(totalSize, alignment);
-        assert(paddingBytes <= buffer.size());
+        checkAvailable(paddingBytes, buffer.size());
         buffer = buffer.subspan(paddingBytes);
 
-        assert(size <= buffer.size());
+        checkAvailable(size, buffer.size());
         auto r = buffer.subspan(0, size);
         buffer = buffer.subspan(size);
         totalSize += size + paddingBytes;
@@ -118,6 +144,42 @@ struct Archive<Mode::LoadMMap> : ArchiveBase<Mode::LoadMMap> {
 
 };
 
+// Like Archive<Mode::LoadMMap>, but buffer is a shared writable mapping:
+// views returned by loadMMap may be written to, which changes the file
+template <>
+struct Archive<Mode::LoadMMapWritable> : ArchiveBase<Mode::LoadMMapWritable> {
+    std::span<char> buffer;
+    size_t totalSize{};
+
+    Archive(std::span<char> _buffer) : buffer{_buffer} {}
+
+    void load(std::span<char> _in, size_t alignment = 1) {
+        auto paddingBytes = requiredPaddingBytes(totalSize, alignment);
+        checkAvailable(paddingBytes, buffer.size());
+        buffer = buffer.subspan(paddingBytes);
+
+        checkAvailable(_in.size(), buffer.size());
+        copyBytes(_in.data(), buffer.data(), _in.size());
+        buffer = buffer.subspan(_in.size());
+        totalSize += _in.size() + paddingBytes;
+    }
+
+    auto loadMMap(size_t alignment = 1) -> std::span<char> {
+        size_t size{};
+        *this & size;
+
+        auto paddingBytes = requiredPaddingBytes(totalSize, alignment);
+        checkAvailable(paddingBytes, buffer.size());
+        buffer = buffer.subspan(paddingBytes);
+
+        checkAvailable(size, buffer.size());
+        auto r = buffer.subspan(0, size);
+        buffer = buffer.subspan(size);
+        totalSize += size + paddingBytes;
+        return r;
+    }
+};
+
 template <>
 struct Archive<Mode::Save> : ArchiveBase<Mode::Save> {
     std::span<char> buffer;
@@ -131,9 +193,7 @@ struct Archive<Mode::Save> : ArchiveBase<Mode::Save> {
         buffer = buffer.subspan(paddingBytes);
 
         assert (_out.size() <= buffer.size());
-        for (size_t i{}; i < _out.size(); ++i) {
-            buffer[i] = _out[i];
-        }
+        copyBytes(buffer.data(), _out.data(), _out.size());
         buffer = buffer.subspan(_out.size());
         totalSize += _out.size() + paddingBytes;
     }
@@ -3,12 +3,27 @@
 #pragma once
 
 #include "Archive.h"
+#include "trivially_copyable.h"
 
 namespace mmser {
 
 template <typename T>
 struct Handler;
 
+// transfers t as sizeof(T) raw bytes
+template <typename Ar, typename T>
+void handleBytes(Ar& ar, T& t) {
+    if constexpr (Ar::loading() || Ar::loadingMMap()) {
+        auto in = std::span<char>{reinterpret_cast<char*>(&t), sizeof(t)};
+        ar.load(in, alignof(T));
+    } else if constexpr (Ar::saving()) {
+        auto out = std::span<char const>{reinterpret_cast<char const*>(&t), sizeof(t)};
+        ar.save(out, alignof(T));
+    } else {
+        ar.storeSize(sizeof(t), alignof(T));
+    }
+}
+
 template <typename Ar, typename T>
 void handle(Ar& ar, T& t) {
     static_assert(
@@ -28,7 +43,10 @@ void handle(Ar& ar, T& t) {
         { Handler<std::remove_cv_t<T>>::serialize(t, ar) };
     };
 
-    if constexpr (hasSerialize) {
+    if constexpr (is_layout_compatible<T>) {
+        static_assert(!std::is_polymorphic_v<T>, "polymorphic types can not be layout compatible");
+        handleBytes(ar, t);
+    } else if constexpr (hasSerialize) {
         t.serialize(ar);
     } else if constexpr (hasLoadAndSave) {
         if constexpr (Ar::loading() || Ar::loadingMMap()) {
@@ -55,15 +73,7 @@ template <typename T>
 struct Handler<T> {
     template <typename Ar>
     static void serialize(auto& t, Ar& ar) {
-        if constexpr (Ar::loading() || Ar::loadingMMap()) {
-            auto in = std::span<char>{reinterpret_cast<char*>(&t), sizeof(t)};
-            ar.load(in, alignof(T));
-        } else if constexpr (Ar::saving()) {
-            auto out = std::span<char const>{reinterpret_cast<char const*>(&t), sizeof(t)};
-            ar.save(out, alignof(T));
-        } else {
-            ar.storeSize(sizeof(t), alignof(T));
-        }
+        handleBytes(ar, t);
     }
 };
 
@@ -0,0 +1,96 @@
+// SPDX-FileCopyrightText: 2025 Simon Gene Gottlieb
+// SPDX-License-Identifier: AGPL-3.0-or-later
+#pragma once
+
+#include "platform.h"
+
+#include <cassert>
+#include <filesystem>
+#include <span>
+#include <stdexcept>
+#include <utility>
+
+#ifdef MMSER_MMAP
+namespace mmser {
+
+// Owns a mapping of a complete file and the file descriptor backing it.
+// Both are released when the object is destroyed.
+// The mapping is read only and private, or with `writable` a shared
+// read-write mapping whose changes are written back to the file.
+struct MMapFile {
+    int fd{-1};
+    std::span<char const> buffer; // the mapped file content
+    bool writable{};
+
+    MMapFile(std::filesystem::path const& path, bool _writable = false)
+        : writable{_writable}
+    {
+        fd = ::open(path.c_str(), writable ? O_RDWR : O_RDONLY);
+        if (fd == -1) {
+            throw std::runtime_error{"file " + path.string() + (writable ? " not writable" : " not readable")};
+        }
+        struct stat st{};
+        if (::fstat(fd, &st) != 0) {
+            ::close(fd);
+            throw std::runtime_error{"file " + path.string() + " not readable, ::fstat error"};
+        }
+        auto size = static_cast<size_t>(st.st_size);
+        if (size == 0) return; // mmap does not accept empty ranges
+        auto ptr = writable ? (char const*)mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0)
+                            : (char const*)mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (ptr == MAP_FAILED) {
+            ::close(fd);
+            throw std::runtime_error{"mmap failed"};
+        }
+        buffer = {ptr, size};
+    }
+
+    MMapFile(MMapFile const&) = delete;
+    MMapFile(MMapFile&& _oth)
+        : fd{std::exchange(_oth.fd, -1)}
+        , buffer{std::exchange(_oth.buffer, {})}
+        , writable{_oth.writable}
+    {}
+
+    auto operator=(MMapFile const&) -> MMapFile& = delete;
+    auto operator=(MMapFile&& _oth) -> MMapFile& {
+        std::swap(fd, _oth.fd);
+        std::swap(buffer, _oth.buffer);
+        std::swap(writable, _oth.writable);
+        return *this;
+    }
+
+    ~MMapFile() {
+        if (buffer.size() > 0) {
+            munmap((void*)buffer.data(), buffer.size());
+        }
+        if (fd != -1) {
+            ::close(fd);
+        }
+    }
+
+    auto data() const -> char const* {
+        return buffer.data();
+    }
+
+    auto size() const -> size_t {
+        return buffer.size();
+    }
+
+    // the mapped file content, only valid for writable mappings
+    auto writableBuffer() const -> std::span<char> {
+        assert(writable);
+        return {const_cast<char*>(buffer.data()), buffer.size()};
+    }
+
+    // writes changes of a writable mapping to the file and waits for completion
+    void flush() const {
+        if (!writable || buffer.empty()) return;
+        if (::msync(const_cast<char*>(buffer.data()), buffer.size(), MS_SYNC) != 0) {
+            throw std::runtime_error{"msync failed"};
+        }
+    }
+};
+
+}
+#endif
@@ -3,5 +3,5 @@
 #pragma once
 
 namespace mmser {
-enum class Mode { Load, LoadMMap, Save, SaveSize };
+enum class Mode { Load, LoadMMap, LoadMMapWritable, Save, SaveSize };
 }
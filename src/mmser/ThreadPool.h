@@ -0,0 +1,126 @@
+// SPDX-FileCopyrightText: 2025 Simon Gene Gottlieb
+// SPDX-License-Identifier: AGPL-3.0-or-later
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace mmser {
+
+// Fixed set of worker threads used by the parallel load and save functions.
+// The thread calling parallel_for participates in the work, so a pool of
+// size 1 has no extra threads and runs everything inline.
+struct ThreadPool {
+    ThreadPool(size_t threads = std::thread::hardware_concurrency()) {
+        threads = std::max<size_t>(threads, 1);
+        for (size_t i{1}; i < threads; ++i) {
+            workers.emplace_back([this] { workerLoop(); });
+        }
+    }
+
+    ThreadPool(ThreadPool const&) = delete;
+    auto operator=(ThreadPool const&) -> ThreadPool& = delete;
+
+    ~ThreadPool() {
+        {
+            auto lock = std::unique_lock{mutex};
+            stop = true;
+        }
+        cvWork.notify_all();
+        for (auto& w : workers) {
+            w.join();
+        }
+    }
+
+    // number of threads working on a parallel_for, including the caller
+    auto size() const -> size_t {
+        return workers.size() + 1;
+    }
+
+    // Calls cb(i) for every i in [0, count) and returns when all calls finished.
+    // Must not be called from inside a cb of the same pool.
+    template <typename CB>
+    void parallel_for(size_t count, CB const& cb) {
+        if (count == 0) return;
+        if (workers.empty() || count == 1) {
+            for (size_t i{0}; i < count; ++i) {
+                cb(i);
+            }
+            return;
+        }
+
+        auto lockSubmit = std::unique_lock{mutexSubmit};
+        auto f = std::function<void(size_t)>{std::cref(cb)};
+        {
+            auto lock = std::unique_lock{mutex};
+            job      = &f;
+            jobCount = count;
+            next     = 0;
+            active   = workers.size();
+            error    = nullptr;
+            generation += 1;
+        }
+        cvWork.notify_all();
+        work();
+        {
+            auto lock = std::unique_lock{mutex};
+            cvDone.wait(lock, [&] { return active == 0; });
+            job = nullptr;
+        }
+        if (error) {
+            std::rethrow_exception(error);
+        }
+    }
+
+private:
+    std::vector<std::thread> workers;
+    std::mutex mutexSubmit; // serializes concurrent parallel_for calls
+    std::mutex mutex;
+    std::condition_variable cvWork;
+    std::condition_variable cvDone;
+
+    std::function<void(size_t)> const* job{};
+    size_t jobCount{};
+    std::atomic<size_t> next{};
+    size_t active{};          // workers that did not finish the current job
+    size_t generation{};      // incremented for every job
+    bool stop{};
+    std::exception_ptr error; // first exception thrown by a cb
+
+    void work() {
+        for (auto i = next.fetch_add(1); i < jobCount; i = next.fetch_add(1)) {
+            try {
+                (*job)(i);
+            } catch (...) {
+                auto lock = std::unique_lock{mutex};
+                if (!error) error = std::current_exception();
+            }
+        }
+    }
+
+    void workerLoop() {
+        size_t seenGeneration{};
+        while (true) {
+            {
+                auto lock = std::unique_lock{mutex};
+                cvWork.wait(lock, [&] { return stop || generation != seenGeneration; });
+                if (stop) return;
+                seenGeneration = generation;
+            }
+            work();
+            {
+                auto lock = std::unique_lock{mutex};
+                active -= 1;
+                if (active == 0) cvDone.notify_one();
+            }
+        }
+    }
+};
+
+}
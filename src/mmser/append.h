@@ -0,0 +1,143 @@
+// SPDX-FileCopyrightText: 2025 Simon Gene Gottlieb
+// SPDX-License-Identifier: AGPL-3.0-or-later
+#pragma once
+
+#include "Archive.h"
+#include "platform.h"
+#include "utils.h"
+#include "vector.h"
+
+#include <atomic>
+#include <cerrno>
+#include <filesystem>
+#include <ranges>
+#include <stdexcept>
+#include <tuple>
+#include <type_traits>
+
+namespace mmser {
+
+#ifdef MMSER_MMAP
+namespace detail {
+// Computes the save size like Archive<Mode::SaveSize> and records the
+// position of the last payload saved with saveMMap (e.g. by an mmser::vector)
+struct ArchiveLocatePayload : ArchiveBase<Mode::SaveSize> {
+    size_t totalSize{};
+    bool found{};
+    size_t sizeOffset{}; // position of the size field of the last payload
+    size_t dataOffset{}; // position of the last payload
+    size_t bytes{};
+    size_t alignment{};
+
+    void storeSize(size_t size, size_t _alignment = 1) {
+        auto paddingBytes = requiredPaddingBytes(totalSize, _alignment);
+        totalSize += size + paddingBytes;
+    }
+    void storeSizeMMap(std::span<char const> _out, size_t _alignment = 1) {
+        auto size = _out.size();
+        *this & size;
+        sizeOffset = totalSize - sizeof(size);
+        storeSize(_out.size(), _alignment);
+        found      = true;
+        dataOffset = totalSize - _out.size();
+        bytes      = _out.size();
+        alignment  = _alignment;
+    }
+};
+}
+
+template <>
+struct is_mmser_t<detail::ArchiveLocatePayload> : std::true_type {};
+
+namespace detail {
+// true if T is a mmser::vector<E> or a tuple whose last element ends in one
+// (other containers save size and index fields that an append would not update)
+template <typename T, typename E>
+struct ends_with_vector : std::false_type {};
+
+template <typename E>
+struct ends_with_vector<mmser::vector<E>, E> : std::true_type {};
+
+template <typename E, typename ...Ts>
+    requires (sizeof...(Ts) > 0)
+struct ends_with_vector<std::tuple<Ts...>, E> : ends_with_vector<std::tuple_element_t<sizeof...(Ts)-1, std::tuple<Ts...>>, E> {};
+}
+
+// T can be extended by appendFile with elements of type E
+template <typename T, typename E>
+concept appendable = detail::ends_with_vector<T, E>::value;
+
+// Appends values to the mmser::vector at the end of the archive at path, which
+// holds a T. T must be that vector or a tuple ending in it.
+// The vector is located by mapping the file and traversing all of T
+// (loadFileMMap<T>), then:
+//  1. the values are written behind the existing elements and synced to disk,
+//  2. the size field is updated with a single atomic store.
+// Readers that load the file concurrently see either the old or the new
+// vector, or get an exception if they determined the file size before the
+// append and read the size field after it (they may simply retry).
+// Readers holding an older mapping keep their (valid) prefix.
+// Left over bytes of an interrupted append are overwritten.
+template <typename T, std::ranges::contiguous_range R>
+    requires (std::is_trivially_copyable_v<std::ranges::range_value_t<R>> && appendable<T, std::ranges::range_value_t<R>>)
+void appendFile(std::filesystem::path const& path, R const& values) {
+    using E = std::ranges::range_value_t<R>;
+    auto newBytes = std::ranges::size(values) * sizeof(E);
+
+    auto locate = detail::ArchiveLocatePayload{};
+    size_t fileSize{};
+    {
+        auto [t, storage] = loadFileMMap<T>(path);
+        handle(locate, t);
+        fileSize = mappedFile(storage)->size();
+    }
+    if (!locate.found || locate.dataOffset + locate.bytes != locate.totalSize || locate.totalSize > fileSize
+        || locate.alignment != alignof(E) || locate.bytes % sizeof(E) != 0) {
+        throw std::runtime_error{"file " + path.string() + " does not end with a vector of the appended type"};
+    }
+    if (newBytes == 0) return;
+
+    auto fd = ::open(path.c_str(), O_RDWR);
+    if (fd == -1) {
+        throw std::runtime_error{"file " + path.string() + " not writable"};
+    }
+    try {
+        auto data   = reinterpret_cast<char const*>(std::ranges::data(values));
+        auto offset = locate.totalSize;
+        auto left   = newBytes;
+        while (left > 0) {
+            auto r = ::pwrite(fd, data, left, offset);
+            if (r < 0) {
+                if (errno == EINTR) continue;
+                throw std::runtime_error{"file " + path.string() + " not writable, ::pwrite error"};
+            }
+            data   += r;
+            offset += r;
+            left   -= r;
+        }
+        // the elements must be on disk before the size field that covers them
+        if (::fdatasync(fd) != 0) {
+            throw std::runtime_error{"file " + path.string() + " not writable, ::fdatasync error"};
+        }
+
+        auto pageSize  = static_cast<size_t>(::sysconf(_SC_PAGESIZE));
+        auto pageBegin = locate.sizeOffset / pageSize * pageSize;
+        auto length    = locate.sizeOffset + sizeof(size_t) - pageBegin;
+        auto ptr = (char*)::mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_SHARED, fd, pageBegin);
+        if (ptr == MAP_FAILED) {
+            throw std::runtime_error{"mmap failed"};
+        }
+        auto& sizeField = *reinterpret_cast<size_t*>(ptr + (locate.sizeOffset - pageBegin));
+        std::atomic_ref{sizeField}.store(locate.bytes + newBytes, std::memory_order_release);
+        ::munmap(ptr, length);
+    } catch (...) {
+        ::close(fd);
+        throw;
+    }
+    if (::close(fd) != 0) {
+        throw std::runtime_error{"::close failed"};
+    }
+}
+#endif
+
+}
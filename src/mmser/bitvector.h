@@ -0,0 +1,231 @@
+// SPDX-FileCopyrightText: 2025 Simon Gene Gottlieb
+// SPDX-License-Identifier: AGPL-3.0-or-later
+#pragma once
+
+#include "platform.h"
+#include "vector.h"
+
+#include <algorithm>
+#include <bit>
+#include <cassert>
+#include <cstdint>
+#include <span>
+
+#if defined(__BMI2__)
+    #include <immintrin.h>
+#endif
+
+namespace mmser {
+
+// position of the k-th (0-based) set bit of x, x must have more than k set bits
+inline auto selectInWord(uint64_t x, size_t k) -> size_t {
+#if defined(__BMI2__)
+    return std::countr_zero(_pdep_u64(uint64_t{1} << k, x));
+#else
+    // broadword: find the byte via prefix sums of byte popcounts, then the bit inside the byte
+    constexpr uint64_t L8 = 0x0101'0101'0101'0101;
+    constexpr uint64_t H8 = 0x8080'8080'8080'8080;
+    auto s = x - ((x >> 1) & 0x5555'5555'5555'5555);
+    s = (s & 0x3333'3333'3333'3333) + ((s >> 2) & 0x3333'3333'3333'3333);
+    s = (s + (s >> 4)) & 0x0f0f'0f0f'0f0f'0f0f;
+    auto byteSums = s * L8; // byte i: number of set bits in bytes 0..i
+    auto place = std::popcount((((k * L8) | H8) - byteSums) & H8) * 8;
+    auto byteRank = k - (((byteSums << 8) >> place) & 0xff);
+    auto byte = (x >> place) & 0xff;
+    for (; byteRank > 0; --byteRank) {
+        byte &= byte - 1;
+    }
+    return place + std::countr_zero(byte);
+#endif
+}
+
+// Bitvector with constant time rank and near constant time select.
+// Rank uses a rank9 layout: per block of 512 bits the number of ones before
+// the block and the seven relative counts of its words, packed into two
+// words. Select looks up a sample every 512 ones (or zeros) and searches the
+// few blocks between two samples.
+// All directories are mmser::vectors, a loaded bitvector answers queries
+// straight from the mapping.
+//
+// After modifications (push_back/set), buildIndex() must be called before
+// using rank or select.
+struct bitvector {
+    static constexpr size_t BlockBits  = 512;
+    static constexpr size_t SelectStep = 512;
+
+    uint64_t count{};                      // number of bits
+    uint64_t ones{};                       // number of set bits
+    mmser::vector<uint64_t> bits;          // padded with zero words
+    mmser::vector<uint64_t> blocks;        // two words per block: absolute rank, 7x9 bit relative ranks
+    mmser::vector<uint64_t> select1Samples; // block containing the (i*SelectStep)-th one
+    mmser::vector<uint64_t> select0Samples; // block containing the (i*SelectStep)-th zero
+
+    bitvector() = default;
+
+    explicit bitvector(size_t n, bool value = false)
+        : count{n}
+        , bits(n / 64 + 1, 0)
+    {
+        if (value) {
+            for (size_t i{0}; i < n / 64; ++i) {
+                bits[i] = ~uint64_t{0};
+            }
+            if (n % 64) bits[n / 64] = ~uint64_t{0} >> (64 - n % 64);
+        }
+        buildIndex();
+    }
+
+    // copies n bits, bit i is (words[i/64] >> (i%64)) & 1
+    bitvector(std::span<uint64_t const> words, size_t n)
+        : count{n}
+        , bits(n / 64 + 1, 0)
+    {
+        assert(words.size() * 64 >= n);
+        for (size_t i{0}; i < (n + 63) / 64; ++i) {
+            bits[i] = words[i];
+        }
+        if (n % 64) bits[n / 64] &= ~uint64_t{0} >> (64 - n % 64);
+        buildIndex();
+    }
+
+    template <typename Ar>
+    void serialize(this auto&& self, Ar& ar) {
+        ar(self.count, self.ones, self.bits, self.blocks, self.select1Samples, self.select0Samples);
+    }
+
+    auto size() const -> size_t {
+        return count;
+    }
+
+    auto empty() const -> bool {
+        return count == 0;
+    }
+
+    auto operator[](size_t i) const -> bool {
+        assert(i < count);
+        return (bits[i / 64] >> (i % 64)) & 1;
+    }
+
+    void set(size_t i, bool value) {
+        assert(i < count);
+        // in a shared writable mapping, ones and the directories in the file
+        // would no longer match the bits, so the bits are copied first
+        if (bits.mapping() == decltype(bits)::Mapping::Shared) {
+            bits.makeOwning();
+        }
+        auto& w = bits[i / 64];
+        w = (w & ~(uint64_t{1} << (i % 64))) | (uint64_t{value} << (i % 64));
+    }
+
+    void push_back(bool value) {
+        count += 1;
+        if (bits.size() < count / 64 + 1) bits.push_back(0);
+        set(count-1, value);
+    }
+
+    // number of set bits in [0, i)
+    auto rank1(size_t i) const -> size_t {
+        assert(i <= count);
+        auto b = i / BlockBits;
+        auto w = (i / 64) % 8;
+        auto r = blocks[2*b] + relativeRank(blocks[2*b+1], w);
+        return r + std::popcount(bits[i / 64] & ((uint64_t{1} << (i % 64)) - 1));
+    }
+
+    // number of unset bits in [0, i)
+    auto rank0(size_t i) const -> size_t {
+        return i - rank1(i);
+    }
+
+    // position of the k-th (0-based) set bit
+    auto select1(size_t k) const -> size_t {
+        assert(k < ones);
+        return select<true>(k);
+    }
+
+    // position of the k-th (0-based) unset bit
+    auto select0(size_t k) const -> size_t {
+        assert(k < count - ones);
+        return select<false>(k);
+    }
+
+    // (re)builds the rank and select directories
+    void buildIndex() {
+        auto blockCount = count / BlockBits + 1;
+        if (bits.size() < blockCount * 8) {
+            bits.resize(blockCount * 8, 0); // complete blocks simplify select
+        }
+        blocks = mmser::vector<uint64_t>(blockCount * 2);
+        select1Samples = {};
+        select0Samples = {};
+        uint64_t total{};
+        for (size_t b{0}; b < blockCount; ++b) {
+            blocks[2*b] = total;
+            uint64_t rel{}, inBlock{};
+            for (size_t w{0}; w < 8; ++w) {
+                if (w > 0) rel |= inBlock << (9 * (w - 1));
+                auto onesBefore  = total + inBlock;
+                auto zerosBefore = b * BlockBits + w * 64 - onesBefore;
+                auto onesHere    = static_cast<uint64_t>(std::popcount(bits.view[b * 8 + w]));
+                // sample every multiple of SelectStep that lies in this word
+                while (select1Samples.size() * SelectStep < onesBefore + onesHere) {
+                    select1Samples.push_back(b);
+                }
+                while (select0Samples.size() * SelectStep < zerosBefore + 64 - onesHere) {
+                    select0Samples.push_back(b);
+                }
+                inBlock += onesHere;
+            }
+            blocks[2*b+1] = rel;
+            total += inBlock;
+        }
+        ones = total;
+    }
+
+private:
+    // number of set bits in words [0, w) of the block
+    static auto relativeRank(uint64_t rel, size_t w) -> uint64_t {
+        // for w == 0 the shift is 63, which always reads a zero
+        auto t = w - 1;
+        return (rel >> ((t + (t >> 60 & 8)) * 9)) & 0x1ff;
+    }
+
+    template <bool One>
+    auto rankBefore(size_t b) const -> uint64_t {
+        if constexpr (One) return blocks[2*b];
+        else return b * BlockBits - blocks[2*b];
+    }
+
+    template <bool One>
+    auto select(size_t k) const -> size_t {
+        auto const& samples = One ? select1Samples : select0Samples;
+        auto j = k / SelectStep;
+        auto lo = samples[j];
+        auto hi = (j + 1 < samples.size()) ? samples[j+1] + 1 : blocks.size() / 2;
+
+        // last block b in [lo, hi) with rankBefore(b) <= k
+        while (hi - lo > 1) {
+            auto mid = lo + (hi - lo) / 2;
+            if (rankBefore<One>(mid) <= k) lo = mid;
+            else hi = mid;
+        }
+        auto b = lo;
+        k -= rankBefore<One>(b);
+
+        // last word w in the block with relative rank <= k
+        auto rel = blocks[2*b+1];
+        size_t w{0};
+        for (size_t i{1}; i < 8; ++i) {
+            auto r = relativeRank(rel, i);
+            if constexpr (!One) r = i * 64 - r;
+            if (r <= k) w = i;
+        }
+        auto r = relativeRank(rel, w);
+        if constexpr (!One) r = w * 64 - r;
+        auto word = bits[b * 8 + w];
+        if constexpr (!One) word = ~word;
+        return b * BlockBits + w * 64 + selectInWord(word, k - r);
+    }
+};
+
+}
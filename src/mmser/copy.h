@@ -0,0 +1,97 @@
+// SPDX-FileCopyrightText: 2025 Simon Gene Gottlieb
+// SPDX-License-Identifier: AGPL-3.0-or-later
+#pragma once
+
+#include "platform.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+namespace mmser {
+
+// Size of the last level cache, payloads larger than this are copied with
+// non-temporal stores so they do not evict the rest of the cache
+inline auto lastLevelCacheSize() -> size_t {
+    static size_t const size = [] {
+        size_t s{};
+#if defined(MMSER_MMAP) && defined(_SC_LEVEL3_CACHE_SIZE)
+        if (auto r = sysconf(_SC_LEVEL3_CACHE_SIZE); r > 0) {
+            s = static_cast<size_t>(r);
+        }
+#endif
+        if (s == 0) s = 32 * 1024 * 1024;
+        return s;
+    }();
+    return size;
+}
+
+#ifdef MMSER_SSE2
+// Copies with streaming stores, bypassing the cache for the destination
+inline void copyBytesNonTemporal(char* dst, char const* src, size_t size) {
+  #ifdef __AVX__
+    using Reg = __m256i;
+  #else
+    using Reg = __m128i;
+  #endif
+    constexpr size_t width = sizeof(Reg);
+
+    // stream stores require an aligned destination
+    auto head = (width - reinterpret_cast<uintptr_t>(dst) % width) % width;
+    if (head > size) head = size;
+    std::memcpy(dst, src, head);
+    dst  += head;
+    src  += head;
+    size -= head;
+
+    auto blocks = size / (4 * width);
+    for (size_t i{0}; i < blocks; ++i) {
+  #ifdef __AVX__
+        auto r0 = _mm256_loadu_si256(reinterpret_cast<Reg const*>(src) + 0);
+        auto r1 = _mm256_loadu_si256(reinterpret_cast<Reg const*>(src) + 1);
+        auto r2 = _mm256_loadu_si256(reinterpret_cast<Reg const*>(src) + 2);
+        auto r3 = _mm256_loadu_si256(reinterpret_cast<Reg const*>(src) + 3);
+        _mm256_stream_si256(reinterpret_cast<Reg*>(dst) + 0, r0);
+        _mm256_stream_si256(reinterpret_cast<Reg*>(dst) + 1, r1);
+        _mm256_stream_si256(reinterpret_cast<Reg*>(dst) + 2, r2);
+        _mm256_stream_si256(reinterpret_cast<Reg*>(dst) + 3, r3);
+  #else
+        auto r0 = _mm_loadu_si128(reinterpret_cast<Reg const*>(src) + 0);
+        auto r1 = _mm_loadu_si128(reinterpret_cast<Reg const*>(src) + 1);
+        auto r2 = _mm_loadu_si128(reinterpret_cast<Reg const*>(src) + 2);
+        auto r3 = _mm_loadu_si128(reinterpret_cast<Reg const*>(src) + 3);
+        _mm_stream_si128(reinterpret_cast<Reg*>(dst) + 0, r0);
+        _mm_stream_si128(reinterpret_cast<Reg*>(dst) + 1, r1);
+        _mm_stream_si128(reinterpret_cast<Reg*>(dst) + 2, r2);
+        _mm_stream_si128(reinterpret_cast<Reg*>(dst) + 3, r3);
+  #endif
+        dst += 4 * width;
+        src += 4 * width;
+    }
+    _mm_sfence();
+    std::memcpy(dst, src, size - blocks * 4 * width);
+}
+#endif
+
+// Bulk transfer used by all archives and containers.
+// Small and medium payloads use memcpy (vectorized by the C library),
+// payloads exceeding the last level cache use non-temporal stores.
+inline void copyBytes(char* dst, char const* src, size_t size) {
+    if (size == 0) return;
+#ifdef MMSER_SSE2
+    if (size >= lastLevelCacheSize()) {
+        copyBytesNonTemporal(dst, src, size);
+        return;
+    }
+#endif
+    std::memcpy(dst, src, size);
+}
+
+template <typename T>
+    requires std::is_trivially_copyable_v<T>
+void copyElements(T* dst, T const* src, size_t count) {
+    copyBytes(reinterpret_cast<char*>(dst), reinterpret_cast<char const*>(src), count * sizeof(T));
+}
+
+}
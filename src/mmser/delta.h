@@ -0,0 +1,202 @@
+// SPDX-FileCopyrightText: 2025 Simon Gene Gottlieb
+// SPDX-License-Identifier: AGPL-3.0-or-later
+#pragma once
+
+#include "Archive.h"
+#include "MMapFile.h"
+#include "platform.h"
+#include "utils.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <filesystem>
+#include <functional>
+#include <optional>
+#include <stdexcept>
+#include <type_traits>
+#include <vector>
+
+namespace mmser {
+
+#ifdef MMSER_MMAP
+// Save archive that compares the saved object with an earlier state of it,
+// the content of `file`, and collects the byte ranges that differ.
+// Payloads of mmser::vectors with known changes (see vector::changesKnown())
+// contribute their dirty chunks without being compared, everything else is
+// compared chunk by chunk. If a size field differs the layout changed and
+// layoutChanged is set.
+struct ArchiveSaveDelta : ArchiveBase<Mode::Save> {
+    static constexpr size_t ChunkBytes = 4096;
+
+    struct Write {
+        size_t offset;    // position in the file
+        size_t size;
+        char const* data; // source in the saved object, or nullptr for copies
+        size_t copy;      // position in copies
+    };
+
+    std::span<char const> file;
+    size_t totalSize{};
+    bool layoutChanged{};
+    std::vector<Write> writes;
+    std::vector<char> copies; // changed values, which might not outlive save() or might change in apply()
+    std::vector<std::function<void()>> trackers; // restart change tracking of the saved vectors
+
+    ArchiveSaveDelta(std::span<char const> _file)
+        : file{_file}
+    {}
+
+    void save(std::span<char const> _out, size_t alignment = 1) {
+        totalSize += requiredPaddingBytes(totalSize, alignment);
+        compare(_out, true);
+        totalSize += _out.size();
+    }
+
+    void saveMMap(std::span<char const> _out, size_t alignment = 1) {
+        saveSizeField(_out.size());
+        totalSize += requiredPaddingBytes(totalSize, alignment);
+        compare(_out, false);
+        totalSize += _out.size();
+    }
+
+    template <typename V>
+        requires (!std::is_const_v<V>)
+    void saveMMapTracked(std::span<char const> _out, size_t alignment, V& v) {
+        trackers.emplace_back([&v]() { v.clearDirty(); });
+        // a view into a mapping of the file (e.g. after swapping two mapped
+        // vectors) could be changed by apply() before it is written
+        auto copy = v.mapping() != V::Mapping::None;
+        saveSizeField(_out.size());
+        totalSize += requiredPaddingBytes(totalSize, alignment);
+        if (!v.changesKnown()) {
+            compare(_out, copy);
+        } else if (!layoutChanged) {
+            v.forEachDirtyRange([&](size_t offset, size_t length) {
+                record(totalSize + offset, _out.subspan(offset, length), copy);
+            });
+        }
+        totalSize += _out.size();
+    }
+
+    // number of bytes that differ
+    auto changedBytes() const -> size_t {
+        size_t r{};
+        for (auto const& w : writes) r += w.size;
+        return r;
+    }
+
+    // writes the collected ranges into the file at path, adjacent ranges are combined
+    void apply(std::filesystem::path const& path) const {
+        auto fd = ::open(path.c_str(), O_WRONLY);
+        if (fd == -1) {
+            throw std::runtime_error{"file " + path.string() + " not writable"};
+        }
+        try {
+            size_t i{0};
+            while (i < writes.size()) {
+                auto offset = writes[i].offset;
+                auto data   = source(writes[i]);
+                auto size   = writes[i].size;
+                for (++i; i < writes.size() && writes[i].offset == offset + size && source(writes[i]) == data + size; ++i) {
+                    size += writes[i].size;
+                }
+                while (size > 0) {
+                    auto r = ::pwrite(fd, data, size, offset);
+                    if (r < 0) {
+                        if (errno == EINTR) continue;
+                        throw std::runtime_error{"file " + path.string() + " not writable, ::pwrite error"};
+                    }
+                    data   += r;
+                    offset += r;
+                    size   -= r;
+                }
+            }
+        } catch (...) {
+            ::close(fd);
+            throw;
+        }
+        if (::close(fd) != 0) {
+            throw std::runtime_error{"::close failed"};
+        }
+    }
+
+private:
+    auto source(Write const& w) const -> char const* {
+        return w.data ? w.data : copies.data() + w.copy;
+    }
+
+    void saveSizeField(size_t size) {
+        auto offset = totalSize + requiredPaddingBytes(totalSize, alignof(size_t));
+        if (offset + sizeof(size) > file.size() || std::memcmp(file.data() + offset, &size, sizeof(size)) != 0) {
+            layoutChanged = true;
+        }
+        *this & size;
+    }
+
+    // records the chunks of _out that differ from the file at totalSize
+    void compare(std::span<char const> _out, bool copy) {
+        if (layoutChanged) return;
+        if (totalSize + _out.size() > file.size()) {
+            layoutChanged = true;
+            return;
+        }
+        for (size_t i{0}; i < _out.size(); i += ChunkBytes) {
+            auto n = std::min(ChunkBytes, _out.size() - i);
+            if (std::memcmp(file.data() + totalSize + i, _out.data() + i, n) == 0) continue;
+            record(totalSize + i, _out.subspan(i, n), copy);
+        }
+    }
+
+    // records that data must be written at offset
+    void record(size_t offset, std::span<char const> data, bool copy) {
+        if (copy) {
+            writes.push_back({offset, data.size(), nullptr, copies.size()});
+            copies.insert(copies.end(), data.begin(), data.end());
+        } else {
+            writes.push_back({offset, data.size(), data.data(), 0});
+        }
+    }
+};
+
+template <>
+struct is_mmser_t<ArchiveSaveDelta> : std::true_type {};
+
+// Updates the file at path, which holds an earlier state of t, by writing
+// only the ranges that changed. mmser::vectors in t track their changed
+// chunks from here on, so the next call only writes those chunks instead of
+// comparing the whole vector.
+// The file must hold the state of the last saveFileDelta(path, t), or be
+// the file t was loaded from (via loadFileMMap or loadFileMMapWritable).
+// If the layout changed (e.g. a vector has a different size) or the file
+// does not exist, a complete new file replaces the old one; mappings of the
+// old file stay valid.
+// Returns the number of bytes written.
+template <typename T>
+auto saveFileDelta(std::filesystem::path const& path, T& t) -> size_t {
+    auto file = std::optional<MMapFile>{};
+    if (std::filesystem::exists(path)) {
+        file.emplace(path);
+    }
+    auto archive = ArchiveSaveDelta{file ? file->buffer : std::span<char const>{}};
+    handle(archive, t);
+
+    size_t written{};
+    if (archive.layoutChanged || archive.totalSize != archive.file.size()) {
+        auto tmp = path;
+        tmp += ".tmp";
+        saveFile(tmp, t);
+        std::filesystem::rename(tmp, path);
+        written = archive.totalSize;
+    } else {
+        archive.apply(path);
+        written = archive.changedBytes();
+    }
+    for (auto const& track : archive.trackers) {
+        track();
+    }
+    return written;
+}
+#endif
+
+}
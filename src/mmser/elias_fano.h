@@ -0,0 +1,144 @@
+// SPDX-FileCopyrightText: 2025 Simon Gene Gottlieb
+// SPDX-License-Identifier: AGPL-3.0-or-later
+#pragma once
+
+#include "bitvector.h"
+#include "packed_vector.h"
+
+#include <algorithm>
+#include <bit>
+#include <cassert>
+#include <cstdint>
+#include <iterator>
+#include <span>
+
+namespace mmser {
+
+// Elias-Fano encoding of a non-decreasing sequence of n integers below U,
+// using about 2 + log(U/n) bits per element.
+// The lower bits of each value are stored in a packed_vector, the upper
+// bits in unary in a bitvector: value i sets bit (value >> lowBits) + i.
+// access() and next_geq() need one select, iteration walks the bits word
+// by word. All parts are mmser::vectors, so it is loaded via mmap without work.
+struct elias_fano {
+    uint64_t count{};
+    uint64_t lowBits{};
+    packed_vector lows;
+    bitvector highs;
+
+    elias_fano() = default;
+
+    // values must be non-decreasing and smaller than 2^64-1
+    explicit elias_fano(std::span<uint64_t const> values)
+        : count{values.size()}
+    {
+        assert(std::ranges::is_sorted(values));
+        assert(values.empty() || values.back() < ~uint64_t{0});
+        auto universe = values.empty() ? 0 : values.back() + 1;
+        lowBits = (count > 0 && universe > count) ? static_cast<uint64_t>(std::bit_width(universe / count)) - 1 : 0;
+
+        lows = packed_vector{lowBits};
+        lows.reserve(count);
+        highs = bitvector((universe >> lowBits) + count + 1);
+        auto lowMask = lowBits == 0 ? 0 : ~uint64_t{0} >> (64 - lowBits);
+        for (size_t i{0}; i < count; ++i) {
+            lows.push_back(values[i] & lowMask);
+            highs.set((values[i] >> lowBits) + i, true);
+        }
+        highs.buildIndex();
+    }
+
+    template <typename Ar>
+    void serialize(this auto&& self, Ar& ar) {
+        ar(self.count, self.lowBits, self.lows, self.highs);
+    }
+
+    auto size() const -> size_t {
+        return count;
+    }
+
+    auto empty() const -> bool {
+        return count == 0;
+    }
+
+    auto access(size_t i) const -> uint64_t {
+        assert(i < count);
+        return value(i, highs.select1(i));
+    }
+
+    auto operator[](size_t i) const -> uint64_t {
+        return access(i);
+    }
+
+    auto back() const -> uint64_t {
+        return access(count-1);
+    }
+
+    // index of the first value that is not less than x, or size()
+    auto next_geq(uint64_t x) const -> size_t {
+        auto h = x >> lowBits;
+        auto zeros = highs.size() - count;
+        if (h >= zeros) return count;
+        // all values with upper bits >= h come after the h-th zero
+        auto pos = h == 0 ? 0 : highs.select0(h-1) + 1;
+        auto i = pos - h;
+        for (; pos < highs.size() && highs[pos]; ++pos, ++i) {
+            if (value(i, pos) >= x) return i;
+        }
+        return i; // upper bits of the next value are larger than h
+    }
+
+    struct const_iterator {
+        using iterator_category = std::forward_iterator_tag;
+        using value_type        = uint64_t;
+        using difference_type   = std::ptrdiff_t;
+
+        elias_fano const* ef{};
+        size_t i{};   // index of the current value
+        size_t pos{}; // position of its set bit in highs
+
+        auto operator*() const -> uint64_t {
+            return ef->value(i, pos);
+        }
+        auto operator++() -> const_iterator& {
+            i += 1;
+            if (i < ef->count) {
+                pos = ef->nextOne(pos+1);
+            }
+            return *this;
+        }
+        auto operator++(int) -> const_iterator {
+            auto r = *this;
+            ++*this;
+            return r;
+        }
+        auto operator==(const_iterator const& other) const -> bool {
+            return i == other.i;
+        }
+    };
+
+    auto begin() const -> const_iterator {
+        return {this, 0, count > 0 ? nextOne(0) : 0};
+    }
+
+    auto end() const -> const_iterator {
+        return {this, count, 0};
+    }
+
+private:
+    auto value(size_t i, size_t pos) const -> uint64_t {
+        return ((pos - i) << lowBits) | lows.get(i);
+    }
+
+    // position of the first set bit in highs at or after p
+    auto nextOne(size_t p) const -> size_t {
+        auto w = p / 64;
+        auto word = highs.bits[w] & (~uint64_t{0} << (p % 64));
+        while (word == 0) {
+            word = highs.bits[++w];
+        }
+        return w * 64 + std::countr_zero(word);
+    }
+};
+
+}
@@ -0,0 +1,240 @@
+// SPDX-FileCopyrightText: 2025 Simon Gene Gottlieb
+// SPDX-License-Identifier: AGPL-3.0-or-later
+#pragma once
+
+#include "Archive.h"
+#include "growing.h"
+#include "platform.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <filesystem>
+#include <memory>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <utility>
+
+namespace mmser {
+
+#ifdef MMSER_MMAP
+// Growable vector whose elements live in a shared mapping of a scratch file
+// instead of anonymous memory, so data sets larger than RAM can be built.
+// The file grows geometrically (ftruncate plus mremap), like ArchiveSaveGrowing.
+//
+// The file is laid out as an archive of (prefix..., mmser::vector<T>) from
+// the start: `prefixBytes` are reserved for values saved in front of the
+// vector, followed by the size field and the aligned elements. finalize()
+// writes the prefix and the size field, trims the file and renames it, the
+// elements are not copied. The result is loaded like any other archive, e.g.
+//   loadFileMMap<std::tuple<Header, mmser::vector<T>>>(target)
+// The scratch file is removed if the vector is destroyed without finalize().
+template <typename T>
+    requires std::is_trivially_copyable_v<T>
+struct file_vector {
+    std::filesystem::path path;
+    int fd{-1};
+    char* ptr{};            // shared mapping of the whole file
+    size_t fileSize{};      // current size of the file and the mapping
+    size_t prefixBytes{};
+    size_t sizeOffset{};    // position of the size field
+    size_t dataOffset{};    // position of the first element
+    size_t count{};
+
+    file_vector(std::filesystem::path _path, size_t _prefixBytes = 0, size_t initialCapacity = 1<<20)
+        : path{std::move(_path)}
+        , prefixBytes{_prefixBytes}
+    {
+        sizeOffset = prefixBytes + requiredPaddingBytes(prefixBytes, alignof(size_t));
+        dataOffset = sizeOffset + sizeof(size_t);
+        dataOffset += requiredPaddingBytes(dataOffset, alignof(T));
+
+        fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0666);
+        if (fd == -1) {
+            throw std::runtime_error{"file " + path.string() + " not writable"};
+        }
+        try {
+            reserveBytes(dataOffset + std::max<size_t>(initialCapacity, sizeof(T)));
+        } catch (...) {
+            ::close(fd);
+            std::filesystem::remove(path);
+            throw;
+        }
+    }
+    file_vector(file_vector const&) = delete;
+    file_vector(file_vector&& _oth)
+        : path{std::move(_oth.path)}
+        , fd{std::exchange(_oth.fd, -1)}
+        , ptr{std::exchange(_oth.ptr, nullptr)}
+        , fileSize{std::exchange(_oth.fileSize, 0)}
+        , prefixBytes{_oth.prefixBytes}
+        , sizeOffset{_oth.sizeOffset}
+        , dataOffset{_oth.dataOffset}
+        , count{std::exchange(_oth.count, 0)}
+    {}
+    auto operator=(file_vector const&) -> file_vector& = delete;
+    auto operator=(file_vector&& _oth) -> file_vector& {
+        std::swap(path, _oth.path);
+        std::swap(fd, _oth.fd);
+        std::swap(ptr, _oth.ptr);
+        std::swap(fileSize, _oth.fileSize);
+        std::swap(prefixBytes, _oth.prefixBytes);
+        std::swap(sizeOffset, _oth.sizeOffset);
+        std::swap(dataOffset, _oth.dataOffset);
+        std::swap(count, _oth.count);
+        return *this;
+    }
+
+    ~file_vector() {
+        discard();
+    }
+
+    auto size() const -> size_t {
+        return count;
+    }
+
+    auto empty() const -> bool {
+        return count == 0;
+    }
+
+    auto capacity() const -> size_t {
+        return (fileSize - dataOffset) / sizeof(T);
+    }
+
+    auto data() -> T* {
+        return reinterpret_cast<T*>(ptr + dataOffset);
+    }
+    auto data() const -> T const* {
+        return reinterpret_cast<T const*>(ptr + dataOffset);
+    }
+
+    auto view() const -> std::span<T const> {
+        return {data(), count};
+    }
+
+    auto operator[](size_t idx) -> T& {
+        assert(idx < count);
+        return data()[idx];
+    }
+    auto operator[](size_t idx) const -> T const& {
+        assert(idx < count);
+        return data()[idx];
+    }
+
+    auto back() -> T& {
+        return (*this)[count-1];
+    }
+    auto back() const -> T const& {
+        return (*this)[count-1];
+    }
+
+    auto begin() -> T* { return data(); }
+    auto end() -> T* { return data() + count; }
+    auto begin() const -> T const* { return data(); }
+    auto end() const -> T const* { return data() + count; }
+
+    void push_back(T const& t) {
+        if (count == capacity()) {
+            reserve(count + 1);
+        }
+        data()[count] = t;
+        count += 1;
+    }
+
+    template <typename ...Args>
+    auto emplace_back(Args&& ...args) -> T& {
+        if (count == capacity()) {
+            reserve(count + 1);
+        }
+        auto p = std::construct_at(data() + count, std::forward<Args>(args)...);
+        count += 1;
+        return *p;
+    }
+
+    // new elements are zero, as the file is extended by ftruncate
+    void resize(size_t n) {
+        if (n > capacity()) {
+            reserveBytes(dataOffset + n * sizeof(T));
+        } else if (n < count) {
+            std::fill(reinterpret_cast<char*>(data() + n), reinterpret_cast<char*>(data() + count), 0);
+        }
+        count = n;
+    }
+
+    void resize(size_t n, T const& v) {
+        auto oldCount = count;
+        resize(n);
+        std::fill(data() + std::min(oldCount, n), data() + n, v);
+    }
+
+    void reserve(size_t n) {
+        if (n <= capacity()) return;
+        reserveBytes(dataOffset + std::max(n, capacity() * 2) * sizeof(T));
+    }
+
+    void clear() {
+        resize(0);
+    }
+
+    // Turns the scratch file into an archive of (prefix..., mmser::vector<T>)
+    // at `target`. The prefix values must take exactly prefixBytes when saved.
+    // The vector must not be used afterwards, on failure the scratch file is
+    // removed.
+    template <typename ...Prefix>
+    void finalize(std::filesystem::path const& target, Prefix const&... prefix) {
+        try {
+            auto sizeArchive = Archive<Mode::SaveSize>{};
+            (handle(sizeArchive, prefix), ...);
+            if (sizeArchive.totalSize != prefixBytes) {
+                throw std::runtime_error{"prefix takes " + std::to_string(sizeArchive.totalSize) + " bytes, but "
+                                         + std::to_string(prefixBytes) + " bytes are reserved"};
+            }
+            [[maybe_unused]] auto archive = Archive<Mode::Save>{std::span{ptr, dataOffset}};
+            (handle(archive, prefix), ...);
+            auto bytes = count * sizeof(T);
+            std::memcpy(ptr + sizeOffset, &bytes, sizeof(bytes));
+
+            if (::munmap(ptr, fileSize) != 0) {
+                throw std::runtime_error{"munmap failed"};
+            }
+            ptr = nullptr;
+            fileSize = 0;
+            count = 0;
+            if (::ftruncate(fd, dataOffset + bytes) != 0) {
+                throw std::runtime_error{"file " + path.string() + " not writable, ::ftruncate error"};
+            }
+            std::filesystem::rename(path, target);
+        } catch (...) {
+            discard();
+            throw;
+        }
+        ::close(fd);
+        fd = -1;
+    }
+
+private:
+    // unmaps, closes and removes the scratch file
+    void discard() noexcept {
+        if (ptr) ::munmap(ptr, fileSize);
+        ptr = nullptr;
+        fileSize = 0;
+        count = 0;
+        if (fd != -1) {
+            ::close(fd);
+            fd = -1;
+            std::error_code ec;
+            std::filesystem::remove(path, ec);
+        }
+    }
+
+    void reserveBytes(size_t required) {
+        if (required <= fileSize) return;
+        ptr = growFileMapping(path, fd, ptr, fileSize, required);
+        fileSize = required;
+    }
+};
+#endif
+
+}
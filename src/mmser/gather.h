@@ -0,0 +1,168 @@
+// SPDX-FileCopyrightText: 2025 Simon Gene Gottlieb
+// SPDX-License-Identifier: AGPL-3.0-or-later
+#pragma once
+
+#include "Archive.h"
+#include "platform.h"
+#include "utils.h"
+
+#include <array>
+#include <cerrno>
+#include <climits>
+#include <cstring>
+#include <filesystem>
+#include <memory>
+#include <stdexcept>
+#include <vector>
+
+#ifdef MMSER_MMAP
+    #include <sys/uio.h>
+#endif
+
+namespace mmser {
+
+#ifdef MMSER_MMAP
+// Save archive that writes with writev, directly from the memory of the saved
+// object: payloads of at least `threshold` bytes are referenced, smaller ones
+// (sizes, scalars, padding) are collected in inline blocks.
+// Referenced payloads must stay valid until the next flush(), which happens
+// when IOV_MAX entries are collected and in close().
+struct ArchiveSaveGather : ArchiveBase<Mode::Save> {
+    static constexpr size_t BlockSize = 1<<16;
+
+    std::filesystem::path path;
+    int fd{-1};
+    size_t totalSize{};
+    size_t threshold{4096};
+
+    std::vector<iovec> iovecs;
+    std::vector<std::unique_ptr<char[]>> blocks; // inline storage, blocks.back() is being filled
+    size_t blockFill{BlockSize};
+
+    ArchiveSaveGather(std::filesystem::path _path)
+        : path{std::move(_path)}
+    {
+        fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0666);
+        if (fd == -1) {
+            throw std::runtime_error{"file " + path.string() + " not writable"};
+        }
+    }
+    ArchiveSaveGather(ArchiveSaveGather const&) = delete;
+    auto operator=(ArchiveSaveGather const&) -> ArchiveSaveGather& = delete;
+
+    ~ArchiveSaveGather() {
+        if (fd != -1) ::close(fd);
+    }
+
+    void save(std::span<char const> _out, size_t alignment = 1) {
+        auto paddingBytes = requiredPaddingBytes(totalSize, alignment);
+        static constexpr auto zeros = std::array<char, 64>{};
+        while (paddingBytes > 0) {
+            auto n = std::min(paddingBytes, zeros.size());
+            append({zeros.data(), n});
+            paddingBytes -= n;
+            totalSize += n;
+        }
+        if (_out.size() >= threshold) {
+            push(_out.data(), _out.size());
+        } else {
+            append(_out);
+        }
+        totalSize += _out.size();
+    }
+    void saveMMap(std::span<char const> _out, size_t alignment = 1) {
+        auto size = _out.size();
+        *this & size;
+        save(_out, alignment);
+    }
+
+    // writes all collected entries
+    void flush() {
+        auto iov = iovecs.data();
+        auto count = iovecs.size();
+        while (count > 0) {
+            auto r = ::writev(fd, iov, static_cast<int>(std::min<size_t>(count, IOV_MAX)));
+            if (r < 0) {
+                if (errno == EINTR) continue;
+                throw std::runtime_error{"file " + path.string() + " not writable, ::writev error"};
+            }
+            // skip over completely written entries, adjust a partially written one
+            auto written = static_cast<size_t>(r);
+            while (count > 0 && written >= iov->iov_len) {
+                written -= iov->iov_len;
+                ++iov;
+                --count;
+            }
+            if (count > 0) {
+                iov->iov_base = static_cast<char*>(iov->iov_base) + written;
+                iov->iov_len -= written;
+            }
+        }
+        iovecs.clear();
+        // keep one block for reuse
+        if (blocks.size() > 1) {
+            std::swap(blocks.front(), blocks.back());
+            blocks.resize(1);
+        }
+        if (!blocks.empty()) {
+            blockFill = 0;
+        }
+    }
+
+    void close() {
+        flush();
+        auto r = ::close(fd);
+        fd = -1;
+        if (r != 0) {
+            throw std::runtime_error{"::close failed"};
+        }
+    }
+
+private:
+    void push(char const* data, size_t size) {
+        if (iovecs.size() == IOV_MAX) {
+            flush();
+        }
+        iovecs.push_back({const_cast<char*>(data), size});
+    }
+
+    // copies data into the inline blocks
+    void append(std::span<char const> data) {
+        while (!data.empty()) {
+            if (iovecs.size() == IOV_MAX) {
+                flush();
+            }
+            if (blockFill == BlockSize) {
+                if (blocks.empty() || !iovecs.empty()) {
+                    blocks.push_back(std::make_unique_for_overwrite<char[]>(BlockSize));
+                }
+                blockFill = 0;
+            }
+            auto dst = blocks.back().get() + blockFill;
+            auto n = std::min(data.size(), BlockSize - blockFill);
+            std::memcpy(dst, data.data(), n);
+            // extend the previous entry if it ends right here
+            if (!iovecs.empty() && static_cast<char*>(iovecs.back().iov_base) + iovecs.back().iov_len == dst) {
+                iovecs.back().iov_len += n;
+            } else {
+                iovecs.push_back({dst, n});
+            }
+            blockFill += n;
+            data = data.subspan(n);
+        }
+    }
+};
+
+template <>
+struct is_mmser_t<ArchiveSaveGather> : std::true_type {};
+
+// Saves t with writev, large arrays are written directly from t's memory
+template <typename T>
+void saveFileGather(std::filesystem::path const& path, T const& t) {
+    auto archive = ArchiveSaveGather{path};
+    handle(archive, t);
+    archive.close();
+}
+#endif
+
+}
@@ -0,0 +1,122 @@
+// SPDX-FileCopyrightText: 2025 Simon Gene Gottlieb
+// SPDX-License-Identifier: AGPL-3.0-or-later
+#pragma once
+
+#include "Archive.h"
+#include "copy.h"
+#include "platform.h"
+#include "utils.h"
+
+#include <algorithm>
+#include <filesystem>
+#include <stdexcept>
+
+namespace mmser {
+
+#ifdef MMSER_MMAP
+// Extends the file fd to newSize bytes and its shared mapping ptr of oldSize
+// bytes along with it (ptr may be nullptr). Returns the new mapping, which
+// might have moved. On failure ptr stays valid.
+inline auto growFileMapping(std::filesystem::path const& path, int fd, char* ptr, size_t oldSize, size_t newSize) -> char* {
+    if (::ftruncate(fd, newSize) != 0) {
+        throw std::runtime_error{"file " + path.string() + " not writable, ::ftruncate error"};
+    }
+    void* p;
+    if (ptr == nullptr) {
+        p = ::mmap(nullptr, newSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    } else {
+#ifdef MREMAP_MAYMOVE
+        p = ::mremap(ptr, oldSize, newSize, MREMAP_MAYMOVE);
+#else
+        p = ::mmap(nullptr, newSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        if (p != MAP_FAILED) ::munmap(ptr, oldSize);
+#endif
+    }
+    if (p == MAP_FAILED) {
+        throw std::runtime_error{"mmap failed"};
+    }
+    return static_cast<char*>(p);
+}
+
+// Save archive that writes into a shared mapping of a file, which grows
+// geometrically (ftruncate plus mremap) while saving and is trimmed to the
+// final size by close().
+// Unlike saveFileMMap/saveFileCopy no computeSaveSize pass is required.
+struct ArchiveSaveGrowing : ArchiveBase<Mode::Save> {
+    std::filesystem::path path;
+    int fd{-1};
+    char* ptr{};       // shared mapping of the whole file
+    size_t capacity{}; // current size of the file and the mapping
+    size_t totalSize{};
+
+    ArchiveSaveGrowing(std::filesystem::path _path, size_t initialCapacity = 1<<20)
+        : path{std::move(_path)}
+    {
+        fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0666);
+        if (fd == -1) {
+            throw std::runtime_error{"file " + path.string() + " not writable"};
+        }
+        try {
+            reserve(std::max<size_t>(initialCapacity, 1));
+        } catch (...) {
+            ::close(fd);
+            throw;
+        }
+    }
+    ArchiveSaveGrowing(ArchiveSaveGrowing const&) = delete;
+    auto operator=(ArchiveSaveGrowing const&) -> ArchiveSaveGrowing& = delete;
+
+    ~ArchiveSaveGrowing() {
+        if (ptr) ::munmap(ptr, capacity);
+        if (fd != -1) ::close(fd);
+    }
+
+    void save(std::span<char const> _out, size_t alignment = 1) {
+        // padding bytes are already zero, the file was extended by ftruncate
+        auto paddingBytes = requiredPaddingBytes(totalSize, alignment);
+        reserve(totalSize + paddingBytes + _out.size());
+        copyBytes(ptr + totalSize + paddingBytes, _out.data(), _out.size());
+        totalSize += _out.size() + paddingBytes;
+    }
+    void saveMMap(std::span<char const> _out, size_t alignment = 1) {
+        auto size = _out.size();
+        *this & size;
+        save(_out, alignment);
+    }
+
+    // unmaps the file and trims it to the written size
+    void close() {
+        if (::munmap(ptr, capacity) != 0) {
+            throw std::runtime_error{"munmap failed"};
+        }
+        ptr = nullptr;
+        auto r = ::ftruncate(fd, totalSize);
+        ::close(fd);
+        fd = -1;
+        if (r != 0) {
+            throw std::runtime_error{"file " + path.string() + " not writable, ::ftruncate error"};
+        }
+    }
+
+private:
+    void reserve(size_t required) {
+        if (required <= capacity) return;
+        auto newCapacity = std::max(required, capacity * 2);
+        ptr = growFileMapping(path, fd, ptr, capacity, newCapacity);
+        capacity = newCapacity;
+    }
+};
+
+template <>
+struct is_mmser_t<ArchiveSaveGrowing> : std::true_type {};
+
+// Saves t in a single pass, without computing its size first
+template <typename T>
+void saveFileGrowing(std::filesystem::path const& path, T const& t) {
+    auto archive = ArchiveSaveGrowing{path};
+    handle(archive, t);
+    archive.close();
+}
+#endif
+
+}
@@ -0,0 +1,79 @@
+// SPDX-FileCopyrightText: 2025 Simon Gene Gottlieb
+// SPDX-License-Identifier: AGPL-3.0-or-later
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+#if defined(_MSC_VER) && !defined(__clang__)
+    #include <intrin.h>
+#endif
+
+namespace mmser {
+
+// Finalizer of splitmix64, maps similar inputs to unrelated outputs
+inline auto mix64(uint64_t x) -> uint64_t {
+    x ^= x >> 30;
+    x *= 0xbf58476d1ce4e5b9ull;
+    x ^= x >> 27;
+    x *= 0x94d049bb133111ebull;
+    x ^= x >> 31;
+    return x;
+}
+
+// Upper 64 bits of a*b, maps a uniform a into [0, b) without a division
+inline auto mulhi64(uint64_t a, uint64_t b) -> uint64_t {
+#if defined(__SIZEOF_INT128__)
+    return static_cast<uint64_t>((static_cast<unsigned __int128>(a) * b) >> 64);
+#elif defined(_MSC_VER) && defined(_M_X64)
+    return __umulh(a, b);
+#else
+    auto aLo = a & 0xffffffffull, aHi = a >> 32;
+    auto bLo = b & 0xffffffffull, bHi = b >> 32;
+    auto mid1 = aHi * bLo + ((aLo * bLo) >> 32);
+    auto mid2 = aLo * bHi + (mid1 & 0xffffffffull);
+    return aHi * bHi + (mid1 >> 32) + (mid2 >> 32);
+#endif
+}
+
+// Hash function for keys of serialized hash tables.
+// Unlike std::hash, the result only depends on the value (and the seed), not
+// on the process or the standard library, so tables can be stored in files.
+template <typename T>
+struct hash;
+
+template <typename T>
+    requires (std::is_integral_v<T> || std::is_enum_v<T>)
+struct hash<T> {
+    auto operator()(T const& value, uint64_t seed = 0) const -> uint64_t {
+        auto v = static_cast<uint64_t>(value);
+        return mix64(v ^ (seed * 0x9e3779b97f4a7c15ull));
+    }
+};
+
+// Hashes the bytes of the object, requires that equal values have equal bytes
+template <typename T>
+    requires (!std::is_integral_v<T> && !std::is_enum_v<T>
+              && std::is_trivially_copyable_v<T>
+              && std::has_unique_object_representations_v<T>)
+struct hash<T> {
+    auto operator()(T const& value, uint64_t seed = 0) const -> uint64_t {
+        auto bytes = reinterpret_cast<char const*>(&value);
+        uint64_t h = mix64(seed ^ (sizeof(T) * 0x9e3779b97f4a7c15ull));
+        size_t i{0};
+        for (; i + 8 <= sizeof(T); i += 8) {
+            uint64_t word;
+            std::memcpy(&word, bytes + i, 8);
+            h = mix64(h ^ word);
+        }
+        if (i < sizeof(T)) {
+            uint64_t word{};
+            std::memcpy(&word, bytes + i, sizeof(T) - i);
+            h = mix64(h ^ word);
+        }
+        return h;
+    }
+};
+
+}
@@ -0,0 +1,247 @@
+// SPDX-FileCopyrightText: 2025 Simon Gene Gottlieb
+// SPDX-License-Identifier: AGPL-3.0-or-later
+#pragma once
+
+#include "hash.h"
+#include "platform.h"
+#include "vector.h"
+
+#include <array>
+#include <bit>
+#include <cstdint>
+#include <cstring>
+
+namespace mmser {
+
+// Open addressing hash map in the style of a swiss table, for trivially
+// copyable keys and values.
+// The table consists of two flat arrays, so a map loaded via mmap answers
+// lookups straight from the mapping: one access to a group of 16 control
+// bytes (compared with a single SIMD instruction) and one to the slot.
+// Inserting or erasing copies a mapped table first, assigning the value of
+// an existing key writes into the mapping (see mmser::vector).
+template <typename K, typename V, typename Hash = mmser::hash<K>>
+    requires (std::is_trivially_copyable_v<K> && std::is_trivially_copyable_v<V>)
+struct hash_map {
+    static constexpr size_t GroupSize = 16;
+    static constexpr int8_t Empty     = -128; // 0b1000'0000
+    static constexpr int8_t Deleted   = -2;   // 0b1111'1110
+    // control bytes of full slots hold the lowest 7 bits of the hash
+
+    struct alignas(GroupSize) group {
+        std::array<int8_t, GroupSize> ctrl;
+    };
+
+    struct slot {
+        K key;
+        V value;
+    };
+
+    mmser::vector<group> groups; // control bytes, groups[i] belongs to slots[i*GroupSize, (i+1)*GroupSize)
+    mmser::vector<slot>  slots;
+    uint64_t count{};            // number of stored elements
+    uint64_t growthLeft{};       // number of empty slots that may be filled before the table grows
+
+    template <typename Ar>
+    void serialize(this auto&& self, Ar& ar) {
+        ar(self.groups, self.slots, self.count, self.growthLeft);
+    }
+
+    auto size() const -> size_t {
+        return count;
+    }
+
+    auto empty() const -> bool {
+        return count == 0;
+    }
+
+    auto capacity() const -> size_t {
+        return slots.size();
+    }
+
+    auto find(K const& key) const -> V const* {
+        auto idx = findIndex(key);
+        if (idx == npos) return nullptr;
+        return &slots.view[idx].value;
+    }
+
+    auto contains(K const& key) const -> bool {
+        return find(key) != nullptr;
+    }
+
+    // inserts the element, if the key does not exist yet
+    // returns true if the element was inserted
+    auto insert(K const& key, V const& value) -> bool {
+        if (find(key)) return false;
+        insertUnique(key, value);
+        return true;
+    }
+
+    void insert_or_assign(K const& key, V const& value) {
+        if (auto idx = findIndex(key); idx != npos) {
+            slots[idx].value = value;
+            return;
+        }
+        insertUnique(key, value);
+    }
+
+    // returns true if the element existed
+    auto erase(K const& key) -> bool {
+        auto idx = findIndex(key);
+        if (idx == npos) return false;
+        makeOwning();
+        auto& grp = groups[idx / GroupSize];
+        // a slot in a group without empty slots might be part of a probe sequence
+        if (match(grp, Empty)) {
+            grp.ctrl[idx % GroupSize] = Empty;
+            growthLeft += 1;
+        } else {
+            grp.ctrl[idx % GroupSize] = Deleted;
+        }
+        count -= 1;
+        return true;
+    }
+
+    void reserve(size_t n) {
+        if (n <= count + growthLeft) return;
+        auto groupCount = std::bit_ceil((n * 8 / 7 + GroupSize) / GroupSize);
+        rehash(groupCount);
+    }
+
+    void clear() {
+        groups = {};
+        slots = {};
+        count = 0;
+        growthLeft = 0;
+    }
+
+    // calls cb(key, value) for every element
+    template <typename CB>
+    void forEach(CB&& cb) const {
+        for (size_t g{0}; g < groups.size(); ++g) {
+            for (size_t i{0}; i < GroupSize; ++i) {
+                if (groups.view[g].ctrl[i] >= 0) {
+                    auto const& s = slots.view[g * GroupSize + i];
+                    cb(s.key, s.value);
+                }
+            }
+        }
+    }
+
+private:
+    static constexpr size_t npos = static_cast<size_t>(-1);
+
+    // index of the slot holding key, or npos
+    auto findIndex(K const& key) const -> size_t {
+        if (groups.size() == 0) return npos;
+        auto h = Hash{}(key);
+        auto mask = groups.size() - 1;
+        auto g = (h >> 7) & mask;
+        for (size_t i{1}; ; ++i) {
+            auto const& grp = groups.view[g];
+            for (auto m = match(grp, static_cast<int8_t>(h & 0x7f)); m; m &= m - 1) {
+                auto idx = g * GroupSize + std::countr_zero(m);
+                if (slots.view[idx].key == key) return idx;
+            }
+            if (match(grp, Empty)) return npos;
+            g = (g + i) & mask;
+        }
+    }
+
+    // bitmask of all control bytes of grp that are equal to b
+    static auto match(group const& grp, int8_t b) -> uint32_t {
+#ifdef MMSER_SSE2
+        auto ctrl = _mm_loadu_si128(reinterpret_cast<__m128i const*>(grp.ctrl.data()));
+        return static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(ctrl, _mm_set1_epi8(b))));
+#else
+        uint32_t r{};
+        for (size_t i{0}; i < GroupSize; ++i) {
+            r |= uint32_t{grp.ctrl[i] == b} << i;
+        }
+        return r;
+#endif
+    }
+
+    // bitmask of all empty or deleted slots of grp
+    static auto matchEmptyOrDeleted(group const& grp) -> uint32_t {
+#ifdef MMSER_SSE2
+        auto ctrl = _mm_loadu_si128(reinterpret_cast<__m128i const*>(grp.ctrl.data()));
+        return static_cast<uint32_t>(_mm_movemask_epi8(ctrl)); // sign bit is only set for empty and deleted
+#else
+        uint32_t r{};
+        for (size_t i{0}; i < GroupSize; ++i) {
+            r |= uint32_t{grp.ctrl[i] < 0} << i;
+        }
+        return r;
+#endif
+    }
+
+    // Copies a mapped table. Control bytes must not be changed in a shared
+    // writable mapping, as count and growthLeft in the file would not match them
+    void makeOwning() {
+        groups.makeOwning();
+        slots.makeOwning();
+    }
+
+    // inserts a key, that is known not to be in the table
+    void insertUnique(K const& key, V const& value) {
+        if (growthLeft == 0) {
+            // many deleted slots: rebuilding at the same size is enough
+            auto groupCount = std::max<size_t>(1, groups.size());
+            if (count + 1 > maxLoad(groupCount * GroupSize) / 2) {
+                groupCount *= 2;
+            }
+            rehash(groupCount);
+        }
+        makeOwning();
+        auto h = Hash{}(key);
+        auto mask = groups.size() - 1;
+        auto g = (h >> 7) & mask;
+        for (size_t i{1}; ; ++i) {
+            auto& grp = groups[g];
+            if (auto m = matchEmptyOrDeleted(grp)) {
+                auto pos = static_cast<size_t>(std::countr_zero(m));
+                if (grp.ctrl[pos] == Empty) {
+                    growthLeft -= 1;
+                }
+                grp.ctrl[pos] = static_cast<int8_t>(h & 0x7f);
+                // member wise, so the padding of the slot stays zero
+                auto& s = slots[g * GroupSize + pos];
+                s.key   = key;
+                s.value = value;
+                count += 1;
+                return;
+            }
+            g = (g + i) & mask;
+        }
+    }
+
+    static auto maxLoad(size_t capacity) -> size_t {
+        return capacity - capacity / 8;
+    }
+
+    void rehash(size_t groupCount) {
+        auto oldGroups = std::move(groups);
+        auto oldSlots  = std::move(slots);
+
+        auto emptyGroup = group{};
+        emptyGroup.ctrl.fill(Empty);
+        groups = mmser::vector<group>(groupCount, emptyGroup);
+        slots  = mmser::vector<slot>(groupCount * GroupSize);
+        // all bytes are saved, including empty slots and padding, they must not hold heap contents
+        std::memset(static_cast<void*>(slots.owningBuffer.data()), 0, slots.size() * sizeof(slot));
+        count = 0;
+        growthLeft = maxLoad(groupCount * GroupSize);
+
+        for (size_t g{0}; g < oldGroups.size(); ++g) {
+            for (size_t i{0}; i < GroupSize; ++i) {
+                if (oldGroups.view[g].ctrl[i] >= 0) {
+                    auto const& s = oldSlots.view[g * GroupSize + i];
+                    insertUnique(s.key, s.value);
+                }
+            }
+        }
+    }
+};
+
+}
@@ -4,6 +4,21 @@
 
 #define MMSER
 
+#include "append.h"
+#include "bitvector.h"
+#include "delta.h"
+#include "elias_fano.h"
+#include "file_vector.h"
+#include "gather.h"
+#include "growing.h"
+#include "hash_map.h"
+#include "packed_vector.h"
+#include "parallel.h"
+#include "perfect_hash.h"
+#include "ragged_vector.h"
+#include "soa_vector.h"
+#include "static_search_tree.h"
+#include "string.h"
 #include "utils.h"
 #include "vector.h"
 #include "std/array.h"
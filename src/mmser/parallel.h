@@ -0,0 +1,196 @@
+// SPDX-FileCopyrightText: 2025 Simon Gene Gottlieb
+// SPDX-License-Identifier: AGPL-3.0-or-later
+#pragma once
+
+#include "ThreadPool.h"
+#include "utils.h"
+
+namespace mmser {
+
+// Splits [0, size) into pieces of at most pieceSize bytes and calls
+// cb(offset, length) for each piece on the threads of the pool
+template <typename CB>
+void parallelPieces(ThreadPool& pool, size_t size, size_t pieceSize, CB const& cb) {
+    auto pieces = (size + pieceSize - 1) / pieceSize;
+    pool.parallel_for(pieces, [&](size_t i) {
+        auto offset = i * pieceSize;
+        cb(offset, std::min(pieceSize, size - offset));
+    });
+}
+
+// Load archive with the same layout as Archive<Mode::Load>.
+// Payloads of at least `threshold` bytes are copied by all threads of the
+// pool, each thread being the first to touch its part of the destination.
+struct ArchiveLoadParallel : ArchiveBase<Mode::Load> {
+    std::span<char const> buffer;
+    size_t totalSize{};
+    ThreadPool* pool;
+    size_t threshold{1024 * 1024}; // smallest payload that is copied in parallel
+    size_t pieceSize{16 * 1024 * 1024};
+
+    ArchiveLoadParallel(std::span<char const> _buffer, ThreadPool& _pool)
+        : buffer{_buffer}
+        , pool{&_pool}
+    {}
+
+    void load(std::span<char> _in, size_t alignment = 1) {
+        auto paddingBytes = requiredPaddingBytes(totalSize, alignment);
+        checkAvailable(paddingBytes, buffer.size());
+        buffer = buffer.subspan(paddingBytes);
+
+        checkAvailable(_in.size(), buffer.size());
+        if (_in.size() >= threshold) {
+            parallelPieces(*pool, _in.size(), pieceSize, [&](size_t offset, size_t size) {
+                copyBytes(_in.data() + offset, buffer.data() + offset, size);
+            });
+        } else {
+            copyBytes(_in.data(), buffer.data(), _in.size());
+        }
+        buffer = buffer.subspan(_in.size());
+        totalSize += _in.size() + paddingBytes;
+    }
+
+    auto loadMMap(size_t alignment = 1) -> std::span<char const> {
+        size_t size{};
+        *this & size;
+
+        auto paddingBytes = requiredPaddingBytes(totalSize, alignment);
+        checkAvailable(paddingBytes, buffer.size());
+        buffer = buffer.subspan(paddingBytes);
+
+        checkAvailable(size, buffer.size());
+        auto r = buffer.subspan(0, size);
+        buffer = buffer.subspan(size);
+        totalSize += size + paddingBytes;
+        return r;
+    }
+};
+
+template <>
+struct is_mmser_t<ArchiveLoadParallel> : std::true_type {};
+
+template <typename T>
+void load(std::span<char const> buffer, T& t, ThreadPool& pool) {
+    auto archive = ArchiveLoadParallel{buffer, pool};
+    handle(archive, t);
+}
+
+// Same result as loadFileCopy(path), but the file is read and large payloads
+// are copied by all threads of the pool
+template <typename T>
+auto loadFileCopy(std::filesystem::path const& path, ThreadPool& pool) -> std::tuple<T, Storage> {
+    auto ret = std::tuple<T, Storage>{};
+
+    auto size = static_cast<size_t>(std::filesystem::file_size(path));
+    // not initialized, so pages are first touched by the reading threads
+    auto buffer = std::make_unique_for_overwrite<char[]>(size);
+#ifdef MMSER_MMAP
+    auto file_fd = ::open(path.c_str(), O_RDONLY);
+    if (file_fd == -1) {
+        throw std::runtime_error{"file " + path.string() + " not readable"};
+    }
+    try {
+        parallelPieces(pool, size, 16 * 1024 * 1024, [&](size_t offset, size_t length) {
+            while (length > 0) {
+                auto r = ::pread(file_fd, buffer.get() + offset, length, offset);
+                if (r <= 0) {
+                    throw std::runtime_error{"file " + path.string() + " not readable, ::pread error"};
+                }
+                offset += r;
+                length -= r;
+            }
+        });
+    } catch (...) {
+        close(file_fd);
+        throw;
+    }
+    close(file_fd);
+#else
+    {
+        auto file = std::ifstream{path, std::ios::in | std::ios::binary};
+        file.read(buffer.get(), size);
+    }
+#endif
+    load(std::span<char const>{buffer.get(), size}, std::get<0>(ret), pool);
+    return ret;
+}
+
+// Save archive with the same layout as Archive<Mode::Save>.
+// Small values are written immediately, payloads of at least `threshold`
+// bytes only have their destination recorded. run() copies them
+// concurrently. Deferred payloads must stay alive until run() returns.
+struct ArchiveSaveParallel : ArchiveBase<Mode::Save> {
+    std::span<char> buffer;
+    size_t totalSize{};
+    size_t threshold{1024 * 1024}; // smallest payload that is deferred
+    size_t pieceSize{16 * 1024 * 1024}; // deferred payloads are split into pieces of this size
+
+    struct Payload {
+        char* dst;
+        char const* src;
+        size_t size;
+    };
+    std::vector<Payload> payloads; // deferred payloads
+
+    ArchiveSaveParallel(std::span<char> _buffer) : buffer{_buffer} {}
+
+    void save(std::span<char const> _out, size_t alignment = 1) {
+        auto paddingBytes = requiredPaddingBytes(totalSize, alignment);
+        assert(totalSize + paddingBytes + _out.size() <= buffer.size());
+        auto dst = buffer.data() + totalSize + paddingBytes;
+        if (_out.size() >= threshold) {
+            payloads.push_back({dst, _out.data(), _out.size()});
+        } else {
+            copyBytes(dst, _out.data(), _out.size());
+        }
+        totalSize += _out.size() + paddingBytes;
+    }
+    void saveMMap(std::span<char const> _out, size_t alignment = 1) {
+        auto size = _out.size();
+        *this & size;
+        save(_out, alignment);
+    }
+
+    void run(ThreadPool& pool) {
+        struct Piece {
+            size_t payload;
+            size_t offset;
+            size_t size;
+        };
+        auto pieces = std::vector<Piece>{};
+        for (size_t i{0}; i < payloads.size(); ++i) {
+            for (size_t offset{0}; offset < payloads[i].size; offset += pieceSize) {
+                pieces.push_back({i, offset, std::min(pieceSize, payloads[i].size - offset)});
+            }
+        }
+        pool.parallel_for(pieces.size(), [&](size_t i) {
+            auto const& p = payloads[pieces[i].payload];
+            copyBytes(p.dst + pieces[i].offset, p.src + pieces[i].offset, pieces[i].size);
+        });
+        payloads.clear();
+    }
+};
+
+template <>
+struct is_mmser_t<ArchiveSaveParallel> : std::true_type {};
+
+template <typename T>
+void save(std::span<char> buffer, T const& t, ThreadPool& pool) {
+    auto archive = ArchiveSaveParallel{buffer};
+    handle(archive, t);
+    archive.run(pool);
+}
+
+#ifdef MMSER_MMAP
+// Same output as saveFileMMap(path, t), but large payloads are copied into
+// the mapping by all threads of the pool
+template <typename T>
+void saveFileMMap(std::filesystem::path const& path, T const& t, ThreadPool& pool) {
+    auto size = computeSaveSize(t);
+    writeFileMMap(path, size, [&](std::span<char> buffer) {
+        save(buffer, t, pool);
+    });
+}
+#endif
+
+}
@@ -0,0 +1,169 @@
+// SPDX-FileCopyrightText: 2025 Simon Gene Gottlieb
+// SPDX-License-Identifier: AGPL-3.0-or-later
+#pragma once
+
+#include "hash.h"
+#include "vector.h"
+
+#include <algorithm>
+#include <bit>
+#include <cassert>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <ranges>
+#include <stdexcept>
+#include <vector>
+
+namespace mmser {
+
+// Minimal perfect hash function (PTHash) over a fixed set of keys.
+// Maps each of the n keys to a distinct index in [0, n), so values can be
+// stored in a plain mmser::vector<V> and accessed via values[ph(key)].
+// Keys that are not part of the set map to an arbitrary index, store the keys
+// as well if membership needs to be checked.
+//
+// Keys are distributed into buckets, each bucket stores a pilot that moves its
+// keys to free positions. A lookup reads one pilot and, for the ~1% of keys
+// that land behind n, one entry of freeSlots.
+template <typename K, typename Hash = mmser::hash<K>>
+struct perfect_hash {
+    uint64_t seed{};
+    uint64_t keyCount{};
+    uint64_t tableSize{};    // number of positions, slightly larger than keyCount
+    uint64_t bucketCount{};
+    uint64_t denseBuckets{}; // first 30% of the buckets receive 60% of the keys
+    mmser::vector<uint32_t> pilots;
+    mmser::vector<uint64_t> freeSlots; // position p >= keyCount is remapped to freeSlots[p - keyCount]
+
+    perfect_hash() = default;
+
+    // keys must be unique
+    // c: trades build time for space, larger values create more buckets
+    // alpha: load factor of the table before it is made minimal
+    template <std::ranges::forward_range R>
+    explicit perfect_hash(R const& keys, double c = 6.0, double alpha = 0.99) {
+        auto hashes = std::vector<uint64_t>{};
+        hashes.reserve(std::ranges::distance(keys));
+        for (uint64_t s{0}; s < 8; ++s) {
+            hashes.clear();
+            for (auto const& key : keys) {
+                hashes.push_back(Hash{}(key, s));
+            }
+            if (build(hashes, s, c, alpha)) return;
+        }
+        throw std::runtime_error{"perfect_hash could not be built, keys are not unique"};
+    }
+
+    template <typename Ar>
+    void serialize(this auto&& self, Ar& ar) {
+        ar(self.seed, self.keyCount, self.tableSize, self.bucketCount, self.denseBuckets, self.pilots, self.freeSlots);
+    }
+
+    auto size() const -> size_t {
+        return keyCount;
+    }
+
+    auto operator()(K const& key) const -> size_t {
+        assert(keyCount > 0);
+        auto h = Hash{}(key, seed);
+        auto p = position(h, pilots[bucket(h)]);
+        if (p < keyCount) return p;
+        return freeSlots[p - keyCount];
+    }
+
+private:
+    auto bucket(uint64_t h) const -> uint64_t {
+        constexpr auto denseKeys = uint64_t{0x9999'9999'9999'9999}; // 0.6 * 2^64
+        auto r = std::rotl(h, 32);
+        if (h < denseKeys) {
+            return mulhi64(r, denseBuckets);
+        }
+        return denseBuckets + mulhi64(r, bucketCount - denseBuckets);
+    }
+
+    auto position(uint64_t h, uint32_t pilot) const -> uint64_t {
+        return mulhi64(mix64(h ^ mix64(pilot + 0x9e3779b97f4a7c15ull)), tableSize);
+    }
+
+    // returns false if two keys have the same hash value
+    auto build(std::vector<uint64_t>& hashes, uint64_t _seed, double c, double alpha) -> bool {
+        seed         = _seed;
+        keyCount     = hashes.size();
+        tableSize    = std::max(keyCount, static_cast<uint64_t>(std::ceil(keyCount / alpha)));
+        bucketCount  = std::max<uint64_t>(2, static_cast<uint64_t>(std::ceil(c * keyCount / std::max(1., std::log2(keyCount)))));
+        denseBuckets = std::max<uint64_t>(1, bucketCount * 3 / 10);
+
+        std::ranges::sort(hashes, [&](uint64_t a, uint64_t b) {
+            auto ba = bucket(a), bb = bucket(b);
+            return ba < bb || (ba == bb && a < b);
+        });
+        if (std::ranges::adjacent_find(hashes) != hashes.end()) return false;
+
+        // keys of bucket b are hashes[bucketStart[b], bucketStart[b+1])
+        auto bucketStart = std::vector<uint64_t>(bucketCount+1, 0);
+        size_t largestBucket{};
+        for (auto h : hashes) {
+            bucketStart[bucket(h)+1] += 1;
+        }
+        for (size_t b{0}; b < bucketCount; ++b) {
+            largestBucket = std::max<size_t>(largestBucket, bucketStart[b+1]);
+            bucketStart[b+1] += bucketStart[b];
+        }
+
+        // process large buckets first, while the table is still empty
+        auto order = std::vector<uint64_t>(bucketCount);
+        {
+            auto sizeStart = std::vector<uint64_t>(largestBucket+2, 0);
+            for (size_t b{0}; b < bucketCount; ++b) {
+                sizeStart[largestBucket - (bucketStart[b+1] - bucketStart[b]) + 1] += 1;
+            }
+            for (size_t i{1}; i < sizeStart.size(); ++i) {
+                sizeStart[i] += sizeStart[i-1];
+            }
+            for (size_t b{0}; b < bucketCount; ++b) {
+                order[sizeStart[largestBucket - (bucketStart[b+1] - bucketStart[b])]++] = b;
+            }
+        }
+
+        auto taken = std::vector<uint64_t>((tableSize + 63) / 64, 0);
+        auto isTaken = [&](uint64_t p) { return (taken[p / 64] >> (p % 64)) & 1; };
+        auto flip    = [&](uint64_t p) { taken[p / 64] ^= uint64_t{1} << (p % 64); };
+
+        pilots = mmser::vector<uint32_t>(bucketCount);
+        auto positions = std::vector<uint64_t>{};
+        for (auto b : order) {
+            auto keys = std::span{hashes}.subspan(bucketStart[b], bucketStart[b+1] - bucketStart[b]);
+            if (keys.empty()) break;
+            for (uint64_t pilot{0}; ; ++pilot) {
+                if (pilot > std::numeric_limits<uint32_t>::max()) return false;
+                positions.clear();
+                for (auto h : keys) {
+                    auto p = position(h, static_cast<uint32_t>(pilot));
+                    if (isTaken(p)) break;
+                    flip(p);
+                    positions.push_back(p);
+                }
+                if (positions.size() == keys.size()) {
+                    pilots[b] = static_cast<uint32_t>(pilot);
+                    break;
+                }
+                for (auto p : positions) {
+                    flip(p);
+                }
+            }
+        }
+
+        // make it minimal: positions behind keyCount are redirected to unused positions in front
+        freeSlots = mmser::vector<uint64_t>(tableSize - keyCount);
+        uint64_t next{0};
+        for (uint64_t p{keyCount}; p < tableSize; ++p) {
+            if (!isTaken(p)) continue;
+            while (isTaken(next)) ++next;
+            freeSlots[p - keyCount] = next++;
+        }
+        return true;
+    }
+};
+
+}
@@ -1,8 +1,25 @@
 // SPDX-FileCopyrightText: 2025 Simon Gene Gottlieb
 // SPDX-License-Identifier: AGPL-3.0-or-later
-
+#pragma once
 
 // Flags that are required for specific platforms
 #if defined(__GNUC__) && !defined(__llvm__) && !defined(__INTEL_COMPILER) && !defined(__INTEL_LLVM_COMPILER)
     #define MMSER_IGNORE_GCC_FLAG_BUG1
 #endif
+
+#if (defined(unix) || defined(__unix__) || defined(__unix))
+    #include <fcntl.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <unistd.h>
+    #define MMSER_MMAP
+#endif
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+    #include <immintrin.h>
+    #define MMSER_SSE2
+#endif
+
+#if defined(MMSER_SSE2) && defined(__AVX2__)
+    #define MMSER_AVX2
+#endif
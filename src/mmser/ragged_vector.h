@@ -0,0 +1,98 @@
+// SPDX-FileCopyrightText: 2025 Simon Gene Gottlieb
+// SPDX-License-Identifier: AGPL-3.0-or-later
+#pragma once
+
+#include "vector.h"
+
+#include <cassert>
+#include <cstdint>
+#include <span>
+
+namespace mmser {
+
+// A sequence of variable length sequences of T (like std::vector<std::vector<T>>)
+// stored as two flat arrays, so it can be loaded via mmap without any work.
+//
+// values holds all inner sequences back to back, inner sequence i is
+// values[offsets[i], offsets[i+1]). offsets is empty or has size()+1 entries.
+template <typename T>
+struct ragged_vector {
+    mmser::vector<uint64_t> offsets;
+    mmser::vector<T> values;
+
+    template <typename Ar>
+    void serialize(this auto&& self, Ar& ar) {
+        ar(self.offsets, self.values);
+    }
+
+    auto size() const -> size_t {
+        return offsets.size() == 0 ? 0 : offsets.size() - 1;
+    }
+
+    auto empty() const -> bool {
+        return size() == 0;
+    }
+
+    // total number of values of all inner sequences
+    auto valueCount() const -> size_t {
+        return values.size();
+    }
+
+    auto operator[](size_t idx) const -> std::span<T const> {
+        assert(idx < size());
+        return values.view.subspan(offsets[idx], offsets[idx+1] - offsets[idx]);
+    }
+
+    auto front() const -> std::span<T const> {
+        return (*this)[0];
+    }
+
+    auto back() const -> std::span<T const> {
+        return (*this)[size()-1];
+    }
+
+    void reserve(size_t innerCount, size_t totalValues) {
+        offsets.reserve(innerCount+1);
+        values.reserve(totalValues);
+    }
+
+    // appends a complete inner sequence
+    void push_back(std::span<T const> inner) {
+        values.makeOwning();
+        values.owningBuffer.insert(values.owningBuffer.end(), inner.begin(), inner.end());
+        values.rebuild();
+        pushOffset();
+    }
+
+    // appends an empty inner sequence, which can be extended by push_back_inner
+    void emplace_back() {
+        pushOffset();
+    }
+
+    // appends a single value to the last inner sequence
+    void push_back_inner(T const& value) {
+        assert(!empty());
+        values.push_back(value);
+        // values was copied out of a shared writable mapping, the offsets in
+        // the file must keep matching the values in the file
+        if (offsets.mapping() == decltype(offsets)::Mapping::Shared) {
+            offsets.makeOwning();
+        }
+        offsets.back() = values.size();
+    }
+
+    void clear() {
+        offsets = {};
+        values = {};
+    }
+
+private:
+    void pushOffset() {
+        if (offsets.size() == 0) {
+            offsets.push_back(0);
+        }
+        offsets.push_back(values.size());
+    }
+};
+
+}
@@ -0,0 +1,125 @@
+// SPDX-FileCopyrightText: 2025 Simon Gene Gottlieb
+// SPDX-License-Identifier: AGPL-3.0-or-later
+#pragma once
+
+#include "vector.h"
+
+#include <cassert>
+#include <span>
+#include <tuple>
+#include <type_traits>
+
+namespace mmser {
+
+namespace detail {
+template <typename T>
+struct member_pointer;
+
+template <typename Class, typename T>
+struct member_pointer<T Class::*> {
+    using class_type = Class;
+    using type       = T;
+};
+
+template <auto A, auto B>
+constexpr bool sameMember() {
+    if constexpr (std::is_same_v<decltype(A), decltype(B)>) {
+        return A == B;
+    } else {
+        return false;
+    }
+}
+}
+
+// Vector of records, stored as one mmser::vector per field (struct of arrays).
+// Fields are given as member pointers, e.g. soa_vector<Point, &Point::x, &Point::y>.
+// Each column is saved as its own aligned payload and loaded via mmap as
+// a view, scans over one field read a contiguous span and nothing else.
+template <typename Record, auto... Fields>
+    requires (sizeof...(Fields) > 0
+              && (std::is_same_v<typename detail::member_pointer<decltype(Fields)>::class_type, Record> && ...)
+              && (std::is_trivially_copyable_v<typename detail::member_pointer<decltype(Fields)>::type> && ...))
+struct soa_vector {
+    std::tuple<mmser::vector<typename detail::member_pointer<decltype(Fields)>::type>...> columns;
+
+    template <typename Ar>
+    void serialize(this auto&& self, Ar& ar) {
+        std::apply([&](auto&... column) {
+            ar(column...);
+        }, self.columns);
+    }
+
+    auto size() const -> size_t {
+        return std::get<0>(columns).size();
+    }
+
+    auto empty() const -> bool {
+        return size() == 0;
+    }
+
+    // column of field I (by position) or of the member pointer F
+    template <size_t I>
+    auto column() const -> auto {
+        return std::get<I>(columns).view;
+    }
+    template <auto F>
+        requires (detail::sameMember<F, Fields>() || ...)
+    auto column() const -> auto {
+        return column<indexOf<F>()>();
+    }
+
+    // assembles record idx, fields not part of the soa_vector are default initialized
+    auto operator[](size_t idx) const -> Record {
+        assert(idx < size());
+        auto r = Record{};
+        forEachField([&](auto field, auto const& column) {
+            r.*field = column[idx];
+        });
+        return r;
+    }
+
+    void set(size_t idx, Record const& r) {
+        assert(idx < size());
+        forEachField([&](auto field, auto& column) {
+            column[idx] = r.*field;
+        });
+    }
+
+    void push_back(Record const& r) {
+        forEachField([&](auto field, auto& column) {
+            column.push_back(r.*field);
+        });
+    }
+
+    void reserve(size_t n) {
+        std::apply([&](auto&... column) { (column.reserve(n), ...); }, columns);
+    }
+
+    void resize(size_t n) {
+        std::apply([&](auto&... column) { (column.resize(n), ...); }, columns);
+    }
+
+    void clear() {
+        columns = {};
+    }
+
+private:
+    template <auto F>
+    static constexpr auto indexOf() -> size_t {
+        size_t i{0}, r{0};
+        ((detail::sameMember<F, Fields>() ? (r = i++) : i++), ...);
+        return r;
+    }
+
+    // calls cb(memberPointer, column) for each field
+    template <typename CB>
+    void forEachField(CB&& cb) {
+        std::apply([&](auto&... column) { (cb(Fields, column), ...); }, columns);
+    }
+    template <typename CB>
+    void forEachField(CB&& cb) const {
+        std::apply([&](auto const&... column) { (cb(Fields, column), ...); }, columns);
+    }
+};
+
+}
@@ -0,0 +1,60 @@
+// SPDX-FileCopyrightText: 2025 Simon Gene Gottlieb
+// SPDX-License-Identifier: AGPL-3.0-or-later
+#pragma once
+
+#include "Archive.h"
+#include "trivially_copyable.h"
+
+#include <algorithm>
+#include <concepts>
+#include <type_traits>
+
+namespace mmser {
+
+// Save size of types whose serialized size does not depend on their value.
+// A specialization provides
+//   advance(offset): total size after saving the type at offset (including padding)
+//   alignment:       largest alignment used inside the type
+//   value:           advance(0)
+// Saving n such values back to back, starting at a multiple of alignment,
+// takes n*value bytes if value is a multiple of alignment. This lets
+// computeSaveSize skip arrays of them instead of visiting every element.
+//
+// User types opt in by listing the types of their serialized fields in order:
+//   template <> struct mmser::static_save_size_t<Point> : mmser::static_save_size_of<float, float> {};
+template <typename T>
+struct static_save_size_t {};
+
+template <typename T>
+concept has_static_save_size = requires {
+    { static_save_size_t<std::remove_cv_t<T>>::value } -> std::convertible_to<size_t>;
+};
+
+// Size of a type that is saved as Size bytes with the given alignment
+template <size_t Size, size_t Alignment>
+struct static_save_size_bytes {
+    static constexpr size_t alignment = Alignment;
+    static constexpr auto advance(size_t offset) -> size_t {
+        return offset + requiredPaddingBytes(offset, Alignment) + Size;
+    }
+    static constexpr size_t value = advance(0);
+};
+
+// Size of a type that saves the given types in this order
+template <typename... Ts>
+    requires (has_static_save_size<Ts> && ...)
+struct static_save_size_of {
+    static constexpr size_t alignment = std::max({size_t{1}, static_save_size_t<std::remove_cv_t<Ts>>::alignment...});
+    static constexpr auto advance(size_t offset) -> size_t {
+        ((offset = static_save_size_t<std::remove_cv_t<Ts>>::advance(offset)), ...);
+        return offset;
+    }
+    static constexpr size_t value = advance(0);
+};
+
+// scalars and types that are transferred as raw bytes
+template <typename T>
+    requires ((std::is_trivially_copyable_v<T> && !std::is_class_v<T>) || is_layout_compatible<T>)
+struct static_save_size_t<T> : static_save_size_bytes<sizeof(T), alignof(T)> {};
+
+}
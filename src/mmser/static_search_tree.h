@@ -0,0 +1,165 @@
+// SPDX-FileCopyrightText: 2025 Simon Gene Gottlieb
+// SPDX-License-Identifier: AGPL-3.0-or-later
+#pragma once
+
+#include "platform.h"
+#include "vector.h"
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cassert>
+#include <cstdint>
+#include <limits>
+#include <span>
+
+namespace mmser {
+
+// Sorted sequence in a static B+ tree layout (S+ tree), for fast lower_bound
+// queries directly from a mapping.
+// Each node is one cache line of keys, a query visits one node per layer
+// (~4 nodes for 10^9 uint64_t keys) instead of ~30 cache lines and pages of a
+// binary search. The leaf layer holds all keys in order, the internal layers
+// hold the smallest key of each child (except the first).
+// All layers are stored in one array, root first.
+template <typename T>
+    requires (std::is_arithmetic_v<T> && 64 % sizeof(T) == 0)
+struct static_search_tree {
+    static constexpr size_t B = 64 / sizeof(T); // keys per node
+    static constexpr size_t MaxHeight = 24;
+
+    struct alignas(64) node {
+        std::array<T, B> keys;
+    };
+
+    uint64_t count{};
+    uint64_t height{};
+    std::array<uint64_t, MaxHeight> layerBegin{}; // index of the first node of each layer, root layer first
+    mmser::vector<node> nodes;
+
+    static_search_tree() = default;
+
+    // sorted must be sorted ascending
+    explicit static_search_tree(std::span<T const> sorted) {
+        assert(std::ranges::is_sorted(sorted));
+        count = sorted.size();
+        if (count == 0) return;
+
+        // number of nodes per layer, leaf layer first
+        auto layerSize = std::array<uint64_t, MaxHeight>{};
+        layerSize[0] = (count + B - 1) / B;
+        height = 1;
+        while (layerSize[height-1] > 1) {
+            layerSize[height] = (layerSize[height-1] + B) / (B + 1);
+            height += 1;
+        }
+        uint64_t total{};
+        for (size_t h{0}; h < height; ++h) {
+            layerBegin[h] = total;
+            total += layerSize[height-1-h];
+        }
+        nodes = mmser::vector<node>(total);
+
+        auto padding = std::numeric_limits<T>::max();
+
+        // leaf layer
+        auto leafs = std::span{nodes.owningBuffer}.subspan(layerBegin[height-1], layerSize[0]);
+        for (size_t i{0}; i < leafs.size(); ++i) {
+            for (size_t j{0}; j < B; ++j) {
+                leafs[i].keys[j] = (i*B + j < count) ? sorted[i*B + j] : padding;
+            }
+        }
+
+        // internal layers, bottom up
+        auto mins = std::vector<T>(leafs.size());
+        for (size_t i{0}; i < leafs.size(); ++i) {
+            mins[i] = leafs[i].keys[0];
+        }
+        for (size_t l{1}; l < height; ++l) {
+            auto layer = std::span{nodes.owningBuffer}.subspan(layerBegin[height-1-l], layerSize[l]);
+            auto nextMins = std::vector<T>(layer.size());
+            for (size_t i{0}; i < layer.size(); ++i) {
+                for (size_t j{0}; j < B; ++j) {
+                    auto child = i*(B+1) + j + 1;
+                    layer[i].keys[j] = (child < mins.size()) ? mins[child] : padding;
+                }
+                nextMins[i] = mins[i*(B+1)];
+            }
+            mins = std::move(nextMins);
+        }
+    }
+
+    template <typename Ar>
+    void serialize(this auto&& self, Ar& ar) {
+        ar(self.count, self.height, self.layerBegin, self.nodes);
+    }
+
+    auto size() const -> size_t {
+        return count;
+    }
+
+    auto empty() const -> bool {
+        return count == 0;
+    }
+
+    // i-th smallest key
+    auto operator[](size_t i) const -> T {
+        assert(i < count);
+        return nodes[layerBegin[height-1] + i / B].keys[i % B];
+    }
+
+    // index of the first key that is not less than x, or size()
+    auto lower_bound(T x) const -> size_t {
+        uint64_t k{0};
+        for (size_t h{0}; h+1 < height; ++h) {
+            k = k * (B+1) + countLess(nodes[layerBegin[h] + k], x);
+        }
+        if (height == 0) return 0;
+        auto rank = k * B + countLess(nodes[layerBegin[height-1] + k], x);
+        return std::min<size_t>(rank, count);
+    }
+
+    auto contains(T x) const -> bool {
+        auto r = lower_bound(x);
+        return r < count && (*this)[r] == x;
+    }
+
+private:
+    // number of keys in n that are smaller than x
+    static auto countLess(node const& n, T x) -> size_t {
+#ifdef MMSER_AVX2
+        if constexpr (std::is_integral_v<T> && (sizeof(T) == 4 || sizeof(T) == 8)) {
+            // AVX2 only compares signed integers, unsigned ones get their sign bit flipped
+            auto flip = [](T v) {
+                if constexpr (std::is_signed_v<T>) return v;
+                else return static_cast<T>(v ^ (T{1} << (sizeof(T)*8 - 1)));
+            };
+            auto lt = [&](__m256i keys, __m256i xv) {
+                if constexpr (sizeof(T) == 4) return _mm256_cmpgt_epi32(xv, keys);
+                else return _mm256_cmpgt_epi64(xv, keys);
+            };
+            __m256i xv, sign;
+            if constexpr (sizeof(T) == 4) {
+                xv   = _mm256_set1_epi32(static_cast<int32_t>(flip(x)));
+                sign = _mm256_set1_epi32(static_cast<int32_t>(flip(T{}) ^ T{}));
+            } else {
+                xv   = _mm256_set1_epi64x(static_cast<int64_t>(flip(x)));
+                sign = _mm256_set1_epi64x(static_cast<int64_t>(flip(T{}) ^ T{}));
+            }
+            auto ptr = reinterpret_cast<__m256i const*>(n.keys.data());
+            auto a = lt(_mm256_xor_si256(_mm256_loadu_si256(ptr),   sign), xv);
+            auto b = lt(_mm256_xor_si256(_mm256_loadu_si256(ptr+1), sign), xv);
+            auto mask = (static_cast<uint64_t>(static_cast<uint32_t>(_mm256_movemask_epi8(b))) << 32)
+                      | static_cast<uint32_t>(_mm256_movemask_epi8(a));
+            return std::popcount(mask) / sizeof(T);
+        }
+#endif
+        size_t r{};
+        for (size_t i{0}; i < B; ++i) {
+            r += n.keys[i] < x;
+        }
+        return r;
+    }
+};
+
+}
@@ -17,4 +17,25 @@ struct Handler<std::array<TEntry, N>> {
     }
 };
 
+template <typename TEntry, size_t N>
+    requires (is_trivially_copyable<TEntry> || has_static_save_size<TEntry>)
+struct static_save_size_t<std::array<TEntry, N>> {
+    static constexpr size_t alignment = [] {
+        if constexpr (is_trivially_copyable<TEntry>) return alignof(TEntry);
+        else return static_save_size_t<TEntry>::alignment;
+    }();
+    static constexpr auto advance(size_t offset) -> size_t {
+        if constexpr (is_trivially_copyable<TEntry>) {
+            // single payload, see Handler<std::span>
+            return offset + requiredPaddingBytes(offset, alignof(TEntry)) + sizeof(TEntry) * N;
+        } else {
+            for (size_t i{0}; i < N; ++i) {
+                offset = static_save_size_t<TEntry>::advance(offset);
+            }
+            return offset;
+        }
+    }
+    static constexpr size_t value = advance(0);
+};
+
 }
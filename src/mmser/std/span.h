@@ -3,6 +3,7 @@
 #pragma once
 
 #include "../Handler.h"
+#include "../static_save_size.h"
 #include "../trivially_copyable.h"
 
 #include <span>
@@ -24,6 +25,14 @@ struct Handler<std::span<TEntry>> {
                 ar.storeSize(sizeof(TEntry)*t.size(), alignof(TEntry));
             }
         } else {
+            if constexpr (has_static_save_size<TEntry> && !Ar::loading() && !Ar::loadingMMap() && !Ar::saving()) {
+                // every element starts at an aligned offset and has the same size
+                using S = static_save_size_t<std::remove_cv_t<TEntry>>;
+                if (ar.totalSize % S::alignment == 0 && S::value % S::alignment == 0) {
+                    ar.totalSize += t.size() * S::value;
+                    return;
+                }
+            }
             for (size_t i{0}; i < t.size(); ++i) {
                 ar(t[i]);
             }
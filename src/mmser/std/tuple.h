@@ -27,4 +27,8 @@ struct Handler<std::tuple<Ts...>> {
     }
 };
 
+template <typename... Ts>
+    requires (has_static_save_size<Ts> && ...)
+struct static_save_size_t<std::tuple<Ts...>> : static_save_size_of<Ts...> {};
+
 }
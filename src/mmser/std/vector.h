@@ -9,8 +9,8 @@
 
 namespace mmser {
 
-template <typename TEntry>
-struct Handler<std::vector<TEntry>> {
+template <typename TEntry, typename Alloc>
+struct Handler<std::vector<TEntry, Alloc>> {
     template <typename Ar>
     static void serialize(auto& t, Ar& ar) {
         uint64_t s = t.size();
@@ -0,0 +1,91 @@
+// SPDX-FileCopyrightText: 2025 Simon Gene Gottlieb
+// SPDX-License-Identifier: AGPL-3.0-or-later
+#pragma once
+
+#include "ragged_vector.h"
+#include "vector.h"
+
+#include <string>
+#include <string_view>
+
+namespace mmser {
+
+// A string which, like mmser::vector<char>, is a view into the mapping when
+// loaded via mmap. Its layout is the same as std::string's, files can be
+// loaded as either type.
+struct string : vector<char> {
+    using vector<char>::vector;
+
+    string() = default;
+    string(std::string_view s) {
+        owningBuffer.assign(s.begin(), s.end());
+        rebuild();
+    }
+    string(char const* s)
+        : string{std::string_view{s}}
+    {}
+
+    auto str() const -> std::string_view {
+        return {view.data(), view.size()};
+    }
+
+    operator std::string_view() const {
+        return str();
+    }
+
+    auto data() const -> char const* {
+        return view.data();
+    }
+
+    auto empty() const -> bool {
+        return size() == 0;
+    }
+
+    friend auto operator==(string const& lhs, string const& rhs) -> bool {
+        return lhs.str() == rhs.str();
+    }
+    friend auto operator==(string const& lhs, std::string_view rhs) -> bool {
+        return lhs.str() == rhs;
+    }
+    friend auto operator==(string const& lhs, char const* rhs) -> bool {
+        return lhs.str() == rhs;
+    }
+};
+
+// Many strings stored in one concatenated blob plus an offsets array.
+// Loading via mmap creates two views, independent of the number of strings.
+struct string_table {
+    ragged_vector<char> strings;
+
+    template <typename Ar>
+    void serialize(this auto&& self, Ar& ar) {
+        ar(self.strings);
+    }
+
+    auto size() const -> size_t {
+        return strings.size();
+    }
+
+    auto empty() const -> bool {
+        return strings.empty();
+    }
+
+    auto operator[](size_t idx) const -> std::string_view {
+        auto s = strings[idx];
+        return {s.data(), s.size()};
+    }
+
+    void reserve(size_t count, size_t totalLength) {
+        strings.reserve(count, totalLength);
+    }
+
+    void push_back(std::string_view s) {
+        strings.push_back(std::span{s.data(), s.size()});
+    }
+
+    void clear() {
+        strings.clear();
+    }
+};
+
+}
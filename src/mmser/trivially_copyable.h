@@ -7,8 +7,18 @@
 
 namespace mmser {
 
+// Opt-in for types that should be saved and loaded as their raw bytes (one
+// copy per object or per array), e.g. records with a user defined copy
+// constructor whose members are all plain data. The in-memory layout of such
+// a type becomes its file format, a serialize() member is not used.
 template <typename T>
-struct is_trivially_copyable_t : std::false_type {};
+struct is_layout_compatible_t : std::false_type {};
+
+template <typename T>
+concept is_layout_compatible = is_layout_compatible_t<std::remove_cv_t<T>>::value;
+
+template <typename T>
+struct is_trivially_copyable_t : is_layout_compatible_t<std::remove_cv_t<T>> {};
 
 template <typename T>
 concept is_trivially_copyable = is_trivially_copyable_t<T>::value;
@@ -4,32 +4,23 @@
 
 #include "Archive.h"
 #include "Handler.h"
+#include "MMapFile.h"
+#include "platform.h"
+#include "static_save_size.h"
 
 #include <any>
 #include <array>
+#include <algorithm>
 #include <cerrno>
 #include <cstring>
 #include <fstream>
 #include <iostream>
+#include <memory>
+#include <tuple>
 #include <vector>
 
-#if (defined(unix) || defined(__unix__) || defined(__unix))
-    #include <fcntl.h>
-    #include <sys/mman.h>
-    #include <sys/stat.h>
-    #include <tuple>
-    #include <unistd.h>
-    #define MMSER_MMAP
-#endif
-
 
 namespace mmser {
-inline auto requiredPaddingBytes(size_t totalSize, size_t alignment) -> size_t {
-    size_t usedBytesOfNextElement = totalSize % alignment;
-    if (usedBytesOfNextElement == 0) return 0;
-    return alignment - usedBytesOfNextElement;
-}
-
 
 template <typename T>
 void load(std::span<char const> buffer, T& t) {
@@ -51,9 +42,13 @@ void save(std::span<char> buffer, T const& t) {
 
 template <typename T>
 size_t computeSaveSize(T const& t) {
-    auto archive = Archive<Mode::SaveSize>{};
-    handle(archive, t);
-    return archive.totalSize;
+    if constexpr (has_static_save_size<T>) {
+        return static_save_size_t<T>::value;
+    } else {
+        auto archive = Archive<Mode::SaveSize>{};
+        handle(archive, t);
+        return archive.totalSize;
+    }
 }
 
 using Storage = std::unique_ptr<std::any>;
@@ -73,6 +68,140 @@ auto loadFileCopy(std::filesystem::path const& path) -> std::tuple<T, Storage> {
     return ret;
 }
 
+#ifdef MMSER_MMAP
+// Load archive reading from a file descriptor through a user-space buffer of
+// bufferSize bytes. Small values are copied out of the buffer, payloads of at
+// least bufferSize bytes are read directly into their destination.
+struct ArchiveLoadStream : ArchiveBase<Mode::Load> {
+    std::filesystem::path path;
+    int fd{-1};
+    size_t totalSize{};
+    size_t bufferSize{};
+
+    std::unique_ptr<char[]> readBuffer;
+    char const* cur{};    // unread bytes of readBuffer are [cur, last)
+    char const* last{};
+    size_t fileOffset{};  // file position of last
+
+    std::vector<char> buffer; // backs the span returned by loadMMap
+
+    ArchiveLoadStream(std::filesystem::path _path, size_t _bufferSize = 1<<16)
+        : path{std::move(_path)}
+    {
+        fd = ::open(path.c_str(), O_RDONLY);
+        if (fd == -1) {
+            throw std::runtime_error{"file " + path.string() + " not readable"};
+        }
+        // no need for a buffer larger than the file
+        struct stat st;
+        if (::fstat(fd, &st) == 0) {
+            _bufferSize = std::min<size_t>(_bufferSize, st.st_size);
+        }
+        bufferSize = std::max<size_t>(_bufferSize, 1);
+        readBuffer = std::make_unique_for_overwrite<char[]>(bufferSize);
+        cur = last = readBuffer.get();
+#if defined(POSIX_FADV_SEQUENTIAL)
+        ::posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+#endif
+    }
+    ArchiveLoadStream(ArchiveLoadStream const&) = delete;
+    auto operator=(ArchiveLoadStream const&) -> ArchiveLoadStream& = delete;
+
+    ~ArchiveLoadStream() {
+        if (fd != -1) ::close(fd);
+    }
+
+    void load(std::span<char> _in, size_t alignment = 1) {
+        auto paddingBytes = requiredPaddingBytes(totalSize, alignment);
+        totalSize += paddingBytes + _in.size();
+
+        // fast path, everything is buffered
+        if (static_cast<size_t>(last - cur) >= paddingBytes + _in.size()) {
+            std::copy_n(cur + paddingBytes, _in.size(), _in.data());
+            cur += paddingBytes + _in.size();
+            return;
+        }
+        skip(paddingBytes);
+        read(_in);
+    }
+
+    // copies the payload into `buffer`, containers use loadInto() instead
+    auto loadMMap(size_t alignment = 1) -> std::span<char const> {
+        auto r = std::span<char>{};
+        loadInto(alignment, [&](size_t size) {
+            buffer.resize(size+alignment-1);
+            size_t offset = alignment - (reinterpret_cast<size_t>(buffer.data()) % alignment);
+            if (offset == alignment) offset = 0;
+            r = {buffer.data() + offset, size};
+            return r;
+        });
+        return r;
+    }
+
+private:
+    void skip(size_t n) {
+        auto buffered = std::min(n, static_cast<size_t>(last - cur));
+        cur += buffered;
+        fileOffset += n - buffered;
+    }
+
+    void read(std::span<char> _in) {
+        auto buffered = std::min(_in.size(), static_cast<size_t>(last - cur));
+        std::copy_n(cur, buffered, _in.data());
+        cur += buffered;
+        _in = _in.subspan(buffered);
+
+        // large payloads bypass the buffer
+        if (_in.size() >= bufferSize) {
+            auto r = readAt(_in.data(), _in.size(), fileOffset);
+            fileOffset += r;
+            if (r < _in.size()) {
+                throw std::runtime_error{"file " + path.string() + " is truncated"};
+            }
+            return;
+        }
+        while (!_in.empty()) {
+            refill();
+            auto n = std::min(_in.size(), static_cast<size_t>(last - cur));
+            std::copy_n(cur, n, _in.data());
+            cur += n;
+            _in = _in.subspan(n);
+        }
+    }
+
+    // reads the next bufferSize bytes of the file into readBuffer
+    void refill() {
+        auto r = readAt(readBuffer.get(), bufferSize, fileOffset);
+        if (r == 0) {
+            throw std::runtime_error{"file " + path.string() + " is truncated"};
+        }
+        cur = readBuffer.get();
+        last = cur + r;
+        fileOffset += r;
+#if defined(POSIX_FADV_WILLNEED)
+        // let the kernel fetch the following block while this one is consumed
+        if (r == bufferSize) {
+            ::posix_fadvise(fd, fileOffset, bufferSize, POSIX_FADV_WILLNEED);
+        }
+#endif
+    }
+
+    // reads up to size bytes at offset, fewer only at the end of the file
+    auto readAt(char* data, size_t size, size_t offset) -> size_t {
+        size_t total{};
+        while (total < size) {
+            auto r = ::pread(fd, data + total, size - total, offset + total);
+            if (r < 0) {
+                if (errno == EINTR) continue;
+                throw std::runtime_error{"file " + path.string() + " not readable, ::pread error"};
+            }
+            if (r == 0) break;
+            total += r;
+        }
+        return total;
+    }
+};
+#else
 struct ArchiveLoadStream : ArchiveBase<Mode::Load> {
     std::ifstream ifs;
     size_t totalSize{};
@@ -107,6 +236,8 @@ struct ArchiveLoadStream : ArchiveBase<Mode::Load> {
     }
 };
 
+#endif
+
 template <>
 struct is_mmser_t<ArchiveLoadStream> : std::true_type {};
 
@@ -121,23 +252,56 @@ auto loadFileStream(std::filesystem::path const& path) -> std::tuple<T, Storage>
 
 
 #ifdef MMSER_MMAP
+// Returns the mapping owned by a Storage object of loadFileMMap, or nullptr if
+// the storage does not own a mapping (e.g. it was returned by loadFileCopy)
+inline auto mappedFile(Storage const& storage) -> MMapFile const* {
+    if (!storage) return nullptr;
+    if (auto file = std::any_cast<std::shared_ptr<MMapFile>>(storage.get())) {
+        return file->get();
+    }
+    return nullptr;
+}
+
 template <typename T>
 auto loadFileMMap(std::filesystem::path const& path) -> std::tuple<T, Storage> {
     auto ret = std::tuple<T, Storage>{};
 
-    auto file_fd = ::open(path.c_str(), O_RDONLY);
-    if (file_fd == -1) {
-        throw std::runtime_error{"file " + path.string() + " not readable"};
-    }
-    auto file_size = static_cast<size_t>(std::filesystem::file_size(path));
-    auto ptr = (char const*)mmap(nullptr, file_size, PROT_READ, MAP_PRIVATE, file_fd, 0);
-    if (ptr == MAP_FAILED) {
-        throw std::runtime_error{"mmap failed"};
-    }
-    auto buffer = std::span<char const>{ptr, file_size};
-    loadMMap(buffer, std::get<0>(ret));
+    // std::any requires copyable types, the mapping itself is only movable
+    auto file = std::make_shared<MMapFile>(path);
+    auto archive = Archive<Mode::LoadMMap>{file->buffer};
+    archive.privateMapping = true;
+    handle(archive, std::get<0>(ret));
+    std::get<1>(ret) = std::make_unique<std::any>(std::move(file));
     return ret;
 }
+
+// Maps the file shared and writable: elements of fixed size containers
+// (e.g. mmser::vector::operator[]) are modified in place in the file.
+// Other readers of the file see changes right away, flush() waits until
+// they are written to disk.
+// In place writes are only supported by containers without derived
+// metadata: mmser::vector, packed_vector::set, soa_vector::set and
+// assigning the value of an existing key of a hash_map. Other modifications
+// (e.g. bitvector::set, whose rank and select directories are saved too, or
+// ragged_vector::push_back_inner) copy the data first and leave the file
+// unchanged.
+template <typename T>
+auto loadFileMMapWritable(std::filesystem::path const& path) -> std::tuple<T, Storage> {
+    auto ret = std::tuple<T, Storage>{};
+
+    auto file = std::make_shared<MMapFile>(path, true);
+    auto archive = Archive<Mode::LoadMMapWritable>{file->writableBuffer()};
+    handle(archive, std::get<0>(ret));
+    std::get<1>(ret) = std::make_unique<std::any>(std::move(file));
+    return ret;
+}
+
+// Writes the changes made to a mapping of loadFileMMapWritable to the file
+inline void flush(Storage const& storage) {
+    if (auto file = mappedFile(storage)) {
+        file->flush();
+    }
+}
 #endif
 
 
@@ -163,6 +327,110 @@ void saveFileCopy(std::filesystem::path const& path, T const& t) {
     }
 }
 
+#ifdef MMSER_MMAP
+// Save archive writing to a file descriptor through a user-space buffer of
+// bufferSize bytes. Small values are collected in the buffer, payloads of at
+// least bufferSize bytes are written directly from their source.
+// close() writes the remaining buffer and reports errors, the destructor
+// only attempts to.
+struct ArchiveSaveStream : ArchiveBase<Mode::Save> {
+    std::filesystem::path path;
+    int fd{-1};
+    size_t totalSize{};
+    size_t bufferSize;
+
+    std::unique_ptr<char[]> writeBuffer;
+    size_t fill{}; // bytes used in writeBuffer
+
+    ArchiveSaveStream(std::filesystem::path _path, size_t _bufferSize = 1<<16)
+        : path{std::move(_path)}
+        , bufferSize{std::max<size_t>(_bufferSize, 1)}
+        , writeBuffer{std::make_unique_for_overwrite<char[]>(bufferSize)}
+    {
+        fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0666);
+        if (fd == -1) {
+            throw std::runtime_error{"file " + path.string() + " not writable"};
+        }
+    }
+    ArchiveSaveStream(ArchiveSaveStream const&) = delete;
+    auto operator=(ArchiveSaveStream const&) -> ArchiveSaveStream& = delete;
+
+    ~ArchiveSaveStream() {
+        if (fd == -1) return;
+        try {
+            flush();
+        } catch (...) {}
+        ::close(fd);
+    }
+
+    void save(std::span<char const> _out, size_t alignment = 1) {
+        auto paddingBytes = requiredPaddingBytes(totalSize, alignment);
+        totalSize += paddingBytes + _out.size();
+
+        // fast path, everything fits into the buffer
+        if (bufferSize - fill >= paddingBytes + _out.size()) {
+            std::memset(writeBuffer.get() + fill, 0, paddingBytes);
+            std::copy_n(_out.data(), _out.size(), writeBuffer.get() + fill + paddingBytes);
+            fill += paddingBytes + _out.size();
+            return;
+        }
+        while (paddingBytes > 0) {
+            if (fill == bufferSize) flush();
+            auto n = std::min(paddingBytes, bufferSize - fill);
+            std::memset(writeBuffer.get() + fill, 0, n);
+            fill += n;
+            paddingBytes -= n;
+        }
+        // large payloads bypass the buffer
+        if (_out.size() >= bufferSize) {
+            flush();
+            writeAll(_out.data(), _out.size());
+            return;
+        }
+        while (!_out.empty()) {
+            if (fill == bufferSize) flush();
+            auto n = std::min(_out.size(), bufferSize - fill);
+            std::copy_n(_out.data(), n, writeBuffer.get() + fill);
+            fill += n;
+            _out = _out.subspan(n);
+        }
+    }
+    void saveMMap(std::span<char const> _out, size_t alignment = 1) {
+        auto size = _out.size();
+        *this & size;
+        save(_out, alignment);
+    }
+
+    // writes the buffered bytes
+    void flush() {
+        auto n = fill;
+        fill = 0;
+        writeAll(writeBuffer.get(), n);
+    }
+
+    void close() {
+        flush();
+        auto r = ::close(fd);
+        fd = -1;
+        if (r != 0) {
+            throw std::runtime_error{"::close failed"};
+        }
+    }
+
+private:
+    void writeAll(char const* data, size_t size) {
+        while (size > 0) {
+            auto r = ::write(fd, data, size);
+            if (r < 0) {
+                if (errno == EINTR) continue;
+                throw std::runtime_error{"file " + path.string() + " not writable, ::write error"};
+            }
+            data += r;
+            size -= r;
+        }
+    }
+};
+#else
 struct ArchiveSaveStream : ArchiveBase<Mode::Save> {
     std::ofstream ofs;
     size_t totalSize{};
@@ -188,6 +456,8 @@ struct ArchiveSaveStream : ArchiveBase<Mode::Save> {
     }
 };
 
+#endif
+
 template <>
 struct is_mmser_t<ArchiveSaveStream> : std::true_type {};
 
@@ -195,34 +465,47 @@ template <typename T>
 void saveFileStream(std::filesystem::path const& path, T const& t) {
     auto archive = ArchiveSaveStream{path};
     handle(archive, t);
+#ifdef MMSER_MMAP
+    archive.close();
+#endif
 }
 
 #ifdef MMSER_MMAP
-template <typename T>
-void saveFileMMap(std::filesystem::path const& path, T const& t) {
-    auto size = computeSaveSize(t);
+// Sets the size of a freshly created file, allocating its blocks upfront
+// where the file system supports it
+inline bool allocateFile(int file_fd, size_t size) {
+#ifdef __linux__
+    if (::fallocate(file_fd, 0, 0, size) == 0) return true;
+#endif
+    return ::ftruncate(file_fd, size) == 0;
+}
 
+// Creates the file `path` with `size` bytes, and calls `cb` with a writable
+// shared mapping of it
+template <typename CB>
+void writeFileMMap(std::filesystem::path const& path, size_t size, CB const& cb) {
     auto file_fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0666);
     if (file_fd == -1) {
         throw std::runtime_error{"file " + path.string() + " not writable"};
     }
 
     if (size > 0) {
-        if (auto r = lseek(file_fd, size-1, SEEK_SET); r == -1) {
+        if (!allocateFile(file_fd, size)) {
             close(file_fd);
-            throw std::runtime_error{"file " + path.string() + " not writable, ::lseek error"};
-        }
-        if (auto r = write(file_fd, "", 1); r != 1) {
-            close(file_fd);
-            throw std::runtime_error{"file " + path.string() + " not writable, ::write error"};
+            throw std::runtime_error{"file " + path.string() + " not writable, ::ftruncate error"};
         }
         auto ptr = (char*)mmap(nullptr, size, PROT_WRITE, MAP_SHARED, file_fd, 0);
         if (ptr == MAP_FAILED) {
             close(file_fd);
             throw std::runtime_error{"mmap failed"};
         }
-        auto buffer = std::span<char>{ptr, size};
-        save(buffer, t);
+        try {
+            cb(std::span<char>{ptr, size});
+        } catch (...) {
+            munmap((void*)ptr, size);
+            close(file_fd);
+            throw;
+        }
         if (auto r = munmap((void*)ptr, size); r != 0) {
             throw std::runtime_error{std::string{"munmap failed: "} + strerror(errno) + "(" + std::to_string(errno) + ")"};
         }
@@ -231,6 +514,14 @@ void saveFileMMap(std::filesystem::path const& path, T const& t) {
         throw std::runtime_error{"::close failed"};
     }
 }
+
+template <typename T>
+void saveFileMMap(std::filesystem::path const& path, T const& t) {
+    auto size = computeSaveSize(t);
+    writeFileMMap(path, size, [&](std::span<char> buffer) {
+        save(buffer, t);
+    });
+}
 #endif
 
 template <typename T>
@@ -2,21 +2,82 @@
 // SPDX-License-Identifier: AGPL-3.0-or-later
 #pragma once
 
+#include "copy.h"
 #include "utils.h"
 #include "platform.h"
 
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
 #include <initializer_list>
+#include <memory>
 
 namespace mmser {
 
+// Allocator which leaves values uninitialized on resize(n) (but not on
+// resize(n, v)). Buffers that are overwritten right away are not zeroed
+// first, and their pages are first touched by the thread filling them.
+template <typename T>
+struct default_init_allocator : std::allocator<T> {
+    using std::allocator<T>::allocator;
+
+    template <typename U>
+    void construct(U* p) noexcept(std::is_nothrow_default_constructible_v<U>) {
+        ::new (static_cast<void*>(p)) U;
+    }
+    template <typename U, typename ...Args>
+    void construct(U* p, Args&&... args) {
+        std::construct_at(p, std::forward<Args>(args)...);
+    }
+};
+
+// Vector that either owns its elements or views them in a mapped file.
+// Mutable element access on a view into a private file mapping (loadFileMMap)
+// does not copy the whole view: the pages of the view are made writable and the
+// kernel copies only the pages that are written to (copy-on-write).
+// A view into a shared writable mapping (loadFileMMapWritable) is written
+// to directly, which changes the file.
+// Operations that change the size still copy the view into owningBuffer.
+//
+// While changes are tracked (after loading via loadFileMMap or
+// loadFileMMapWritable, or after clearDirty()), the chunks of ChunkBytes
+// bytes touched by mutable element access or by size changes are recorded,
+// see forEachDirtyRange(). Writes through owningBuffer are not tracked.
+// The recorded chunks refer to the position of the vector in the saved file:
+// a new vector takes them over from the vector it is moved from, while
+// assigning stops the tracking (e.g. std::swap of two tracked vectors).
+//
+// Threads may write different elements concurrently only after the first
+// mutable access (or makeWritable()) happened on a single thread, because
+// that access may change the mapping and start the tracking.
 template <typename T>
 struct vector {
-    std::span<T const> view;     // view on the data, either on a mmap or on owningBuffer
-    std::vector<T> owningBuffer; // only in use if this struct actually owns the data
+    static constexpr size_t ChunkBytes = 4096;
+
+    enum class Mapping : uint8_t {
+        None,     // view is on owningBuffer or on a buffer that must not be written
+        Private,  // view is in a private file mapping
+        Writable, // view is in a private file mapping, which was made writable
+        Shared,   // view is in a shared writable file mapping
+    };
+
+    std::span<T const> view; // view on the data, either on a mmap or on owningBuffer
+    // only in use if this struct actually owns the data. Not a std::vector<T>:
+    // the allocator lets loading fill it without zeroing it first
+    std::vector<T, default_init_allocator<T>> owningBuffer;
+
+    // only allocated while the view is in a file mapping or changes are
+    // tracked, other vectors pay a single pointer
+    struct FileState {
+        Mapping mapping{Mapping::None};
+        bool tracking{};                   // changes are recorded in dirtyChunks
+        std::vector<uint64_t> dirtyChunks; // one bit per chunk of view
+    };
+    std::unique_ptr<FileState> fileState;
 
     vector() = default;
     vector(size_t _size)
-        : owningBuffer(_size)
+        : owningBuffer(_size, T{})
     {
         rebuild();
     }
@@ -29,8 +90,10 @@ struct vector {
     vector(vector const& _oth) {
         *this = _oth;
     }
-    vector(vector&& _oth) {
-        *this = std::move(_oth);
+    vector(vector&& _oth)
+        : fileState{std::move(_oth.fileState)}
+    {
+        takeData(_oth);
     }
 
     vector(std::initializer_list<T> list)
@@ -40,19 +103,20 @@ struct vector {
     }
 
     auto operator=(vector const& _oth) -> auto& {
+        stopTracking();
         owningBuffer.assign(_oth.view.begin(), _oth.view.end());
         rebuild();
         return *this;
     }
     auto operator=(vector&& _oth) -> auto& {
-        if (_oth.size() == 0) return *this;
-        if (_oth.owningBuffer.size() == 0) {
-            owningBuffer = std::move(_oth.owningBuffer);
-            view = _oth.view;
-            return *this;
+        if (this == &_oth) return *this;
+        auto m = _oth.mapping();
+        takeData(_oth);
+        fileState.reset();
+        if (m != Mapping::None) {
+            fileState = std::make_unique<FileState>();
+            fileState->mapping = m;
         }
-        owningBuffer = std::move(_oth.owningBuffer);
-        rebuild();
         return *this;
     }
 
@@ -60,21 +124,40 @@ struct vector {
     void serialize(this auto&& self, Ar& ar) {
         if constexpr (is_mmser<std::remove_cvref_t<Ar>>) {
             if constexpr (Ar::loading()) {
-                auto data = ar.loadMMap(alignof(T));
-                auto data2 = std::span{reinterpret_cast<T const*>(data.data()), data.size()/sizeof(T)};
-                self.owningBuffer.resize(data2.size());
-                for (size_t i{0}; i < data2.size(); ++i) {
-                    self.owningBuffer[i] = data2[i];
-                }
+                // same layout as loadMMap(), but the archive writes directly into owningBuffer
+                self.stopTracking();
+                ar.loadInto(alignof(T), [&](size_t size) {
+                    assert(size % sizeof(T) == 0);
+                    self.owningBuffer.resize(size/sizeof(T));
+                    return std::span{reinterpret_cast<char*>(self.owningBuffer.data()), size};
+                });
                 self.rebuild();
             } else if constexpr (Ar::loadingMMap()) {
                 self.owningBuffer.clear();
+                self.fileState.reset();
                 auto data = ar.loadMMap(alignof(T));
                 auto data2 = std::span{reinterpret_cast<T const*>(data.data()), data.size()/sizeof(T)};
                 self.view = data2;
+                auto m = Mapping::None;
+                if constexpr (Ar::loadingMMapWritable()) {
+                    m = Mapping::Shared;
+                } else if constexpr (requires { ar.privateMapping; }) {
+                    if (ar.privateMapping && std::is_trivially_copyable_v<T>) {
+                        m = Mapping::Private;
+                    }
+                }
+                if (m != Mapping::None) {
+                    self.fileState = std::make_unique<FileState>();
+                    self.fileState->mapping = m;
+                    self.clearDirty(); // the view is the content of the file
+                }
             } else if constexpr (Ar::saving()) {
                 auto data = std::span{reinterpret_cast<char const*>(self.view.data()), self.size()*sizeof(T)};
-                ar.saveMMap(data, alignof(T));
+                if constexpr (requires { ar.saveMMapTracked(data, alignof(T), self); }) {
+                    ar.saveMMapTracked(data, alignof(T), self);
+                } else {
+                    ar.saveMMap(data, alignof(T));
+                }
             } else {
                 auto data = std::span{reinterpret_cast<char const*>(self.view.data()), self.size()*sizeof(T)};
                 ar.storeSizeMMap(data, alignof(T));
@@ -94,19 +177,30 @@ struct vector {
         return view[idx];
     }
     auto operator[](size_t idx) -> auto& {
-        makeOwning();
-        return owningBuffer[idx];
+        return element(idx);
     }
 
     void rebuild() {
+        auto oldSize = size();
         view = {owningBuffer.data(), owningBuffer.size()};
+        if (!fileState) return;
+        if (!fileState->tracking) {
+            fileState.reset();
+            return;
+        }
+        fileState->mapping = Mapping::None;
+        // elements between the old and the new end changed
+        fileState->dirtyChunks.resize((chunkCount() + 63) / 64);
+        markDirtyBytes(std::min(oldSize, size()) * sizeof(T), size() * sizeof(T));
     }
     void makeOwning() {
         if (owningBuffer.size() > 0) return;
         if (size() == 0) return;
-        owningBuffer.reserve(size());
-        for (size_t i{0}; i < size(); ++i) {
-            owningBuffer.push_back(view[i]);
+        if constexpr (std::is_trivially_copyable_v<T>) {
+            owningBuffer.resize(size());
+            copyElements(owningBuffer.data(), view.data(), size());
+        } else {
+            owningBuffer.assign(view.begin(), view.end());
         }
         rebuild();
     }
@@ -119,14 +213,16 @@ struct vector {
     template <typename ...Args>
     void emplace_back(Args&& ...args) {
         makeOwning();
-        owningBuffer.emplace_back(std::forward<Args>(args)...);
+        if constexpr (sizeof...(Args) == 0) {
+            owningBuffer.emplace_back(T{}); // owningBuffer would not initialize it
+        } else {
+            owningBuffer.emplace_back(std::forward<Args>(args)...);
+        }
         rebuild();
     }
 
     void resize(size_t s) {
-        makeOwning();
-        owningBuffer.resize(s);
-        rebuild();
+        resize(s, T{});
     }
 
     void resize(size_t s, T const& v) {
@@ -149,13 +245,174 @@ struct vector {
     }
 
     auto back() -> auto& {
-        makeOwning();
-        return owningBuffer.back();
+        return element(size()-1);
     }
 
     auto back() const -> auto const& {
         return view.back();
     }
+
+    // Makes the elements writable, without copying them if the view is in a
+    // private file mapping. Otherwise the elements are copied into owningBuffer.
+    void makeWritable() {
+        if (owningBuffer.size() > 0 || mapping() == Mapping::Writable || mapping() == Mapping::Shared) return;
+#ifdef MMSER_MMAP
+        if (mapping() == Mapping::Private && size() > 0) {
+            auto pageSize = static_cast<uintptr_t>(::sysconf(_SC_PAGESIZE));
+            auto first = reinterpret_cast<uintptr_t>(view.data()) & ~(pageSize - 1);
+            auto last  = reinterpret_cast<uintptr_t>(view.data() + size());
+            if (::mprotect(reinterpret_cast<void*>(first), last - first, PROT_READ | PROT_WRITE) == 0) {
+                fileState->mapping = Mapping::Writable;
+                if (!fileState->tracking) clearDirty();
+                return;
+            }
+        }
+#endif
+        makeOwning();
+    }
+
+    // Calls cb(offset, length) for each run of chunks changed since the
+    // view was made writable or since clearDirty(); offset and length are in
+    // bytes relative to the beginning of the view.
+    // The view itself always shows the merged state and can be saved as usual.
+    template <typename CB>
+    void forEachDirtyRange(CB&& cb) const {
+        if (!tracking()) return;
+        auto bytes = size() * sizeof(T);
+        size_t c{0};
+        while (c < chunkCount()) {
+            if (!isDirty(c)) { ++c; continue; }
+            auto begin = c;
+            while (c < chunkCount() && isDirty(c)) ++c;
+            cb(begin * ChunkBytes, std::min(c * ChunkBytes, bytes) - begin * ChunkBytes);
+        }
+    }
+
+    // starts tracking changes, or forgets the recorded ones
+    void clearDirty() {
+        if (!fileState) fileState = std::make_unique<FileState>();
+        fileState->tracking = true;
+        fileState->dirtyChunks.assign((chunkCount() + 63) / 64, 0);
+    }
+
+    void stopTracking() {
+        if (!fileState) return;
+        if (fileState->mapping == Mapping::None) {
+            fileState.reset();
+            return;
+        }
+        fileState->tracking = false;
+        fileState->dirtyChunks.clear();
+    }
+
+    auto mapping() const -> Mapping {
+        return fileState ? fileState->mapping : Mapping::None;
+    }
+
+    auto tracking() const -> bool {
+        return fileState && fileState->tracking;
+    }
+
+    // true if all changes since the view was loaded from a file or since
+    // clearDirty() are known
+    auto changesKnown() const -> bool {
+        return tracking();
+    }
+
+private:
+    // moves the data (but not the file state) of _oth, which is left empty
+    void takeData(vector& _oth) {
+        if (_oth.owningBuffer.size() == 0) {
+            owningBuffer = std::move(_oth.owningBuffer);
+            view = _oth.view;
+        } else {
+            owningBuffer = std::move(_oth.owningBuffer);
+            view = {owningBuffer.data(), owningBuffer.size()};
+        }
+        _oth.owningBuffer.clear();
+        _oth.view = {};
+        _oth.fileState.reset();
+    }
+
+    auto element(size_t idx) -> T& {
+        if (!fileState) {
+            // owned, or a view on a buffer that must not be written
+            makeOwning();
+            return owningBuffer[idx];
+        }
+        makeWritable();
+        if (tracking()) {
+            markDirty(idx);
+        }
+        if (mapping() == Mapping::None) {
+            return owningBuffer[idx];
+        }
+        return const_cast<T&>(view[idx]);
+    }
+
+    auto chunkCount() const -> size_t {
+        return (size() * sizeof(T) + ChunkBytes - 1) / ChunkBytes;
+    }
+
+    auto isDirty(size_t chunk) const -> bool {
+        return (fileState->dirtyChunks[chunk / 64] >> (chunk % 64)) & 1;
+    }
+
+    void markDirty(size_t idx) {
+        markDirtyBytes(idx * sizeof(T), (idx+1) * sizeof(T));
+    }
+
+    // marks the chunks overlapping the bytes [first, last), the bits are
+    // only accessed atomically, so writes to different elements may race
+    void markDirtyBytes(size_t first, size_t last) {
+        for (auto c = first / ChunkBytes; c * ChunkBytes < last; ++c) {
+            auto bit  = uint64_t{1} << (c % 64);
+            auto word = std::atomic_ref{fileState->dirtyChunks[c / 64]};
+            if ((word.load(std::memory_order_relaxed) & bit) == 0) {
+                word.fetch_or(bit, std::memory_order_relaxed);
+            }
+        }
+    }
 };
 
+#ifdef MMSER_MMAP
+// Writes the chunks of v written to since loadFileMMap (or the last
+// writeBack) into the file at path, which storage must be the mapping of.
+// Only the dirty ranges are written, the rest of the file is untouched.
+template <typename T>
+void writeBack(std::filesystem::path const& path, Storage const& storage, vector<T>& v) {
+    auto file = mappedFile(storage);
+    auto data = reinterpret_cast<char const*>(v.view.data());
+    if (file == nullptr || data < file->data() || data + v.size() * sizeof(T) > file->data() + file->size()) {
+        throw std::runtime_error{"vector is not a view into the mapping of " + path.string()};
+    }
+    auto fileOffset = static_cast<size_t>(data - file->data());
+
+    auto fd = ::open(path.c_str(), O_WRONLY);
+    if (fd == -1) {
+        throw std::runtime_error{"file " + path.string() + " not writable"};
+    }
+    try {
+        v.forEachDirtyRange([&](size_t offset, size_t length) {
+            while (length > 0) {
+                auto r = ::pwrite(fd, data + offset, length, fileOffset + offset);
+                if (r < 0) {
+                    if (errno == EINTR) continue;
+                    throw std::runtime_error{"file " + path.string() + " not writable, ::pwrite error"};
+                }
+                offset += r;
+                length -= r;
+            }
+        });
+    } catch (...) {
+        ::close(fd);
+        throw;
+    }
+    if (::close(fd) != 0) {
+        throw std::runtime_error{"::close failed"};
+    }
+    v.clearDirty();
+}
+#endif
+
 }
@@ -492,3 +492,1303 @@ TEST_CASE("Tests mmser - vector", "[mmser][vector][int16_t][file]") {
     }
 #endif
 }
+
+#ifdef MMSER_MMAP
+TEST_CASE("Tests mmser - storage owns mapping", "[mmser][vector][int16_t][file][mmap]") {
+    mmser::vector<int16_t> input;
+
+    input.push_back(1);
+    input.push_back(5);
+    input.push_back(6);
+
+    auto filename = std::filesystem::temp_directory_path() / std::filesystem::path{"unit_test_mmser_storage"};
+    mmser::saveFile(filename, input);
+
+    for (size_t i{0}; i < 100; ++i) {
+        auto [output, storageManager] = mmser::loadFileMMap<mmser::vector<int16_t>>(filename);
+
+        auto file = mmser::mappedFile(storageManager);
+        REQUIRE(file != nullptr);
+        CHECK(file->size() == std::filesystem::file_size(filename));
+        CHECK(output.view.data() >= reinterpret_cast<int16_t const*>(file->data()));
+        CHECK(output.view.data() < reinterpret_cast<int16_t const*>(file->data() + file->size()));
+        REQUIRE(output.size() == input.size());
+        for (size_t j{0}; j < output.size(); ++j) {
+            CHECK(output[j] == input[j]);
+        }
+
+        auto fd = file->fd;
+        storageManager.reset();
+        CHECK(fcntl(fd, F_GETFD) == -1);
+    }
+
+    { // storage of a copied file does not hold a mapping
+        auto [output, storageManager] = mmser::loadFileCopy<mmser::vector<int16_t>>(filename);
+        CHECK(mmser::mappedFile(storageManager) == nullptr);
+    }
+
+    { // empty files can be mapped
+        auto emptyFile = std::filesystem::temp_directory_path() / std::filesystem::path{"unit_test_mmser_storage_empty"};
+        mmser::saveFile(emptyFile, std::tuple<>{});
+        auto [output, storageManager] = mmser::loadFileMMap<std::tuple<>>(emptyFile);
+        REQUIRE(mmser::mappedFile(storageManager) != nullptr);
+        CHECK(mmser::mappedFile(storageManager)->size() == 0);
+    }
+}
+#endif
+
+TEST_CASE("Tests mmser - bulk copy", "[mmser][copy]") {
+    // larger than the last level cache, to exercise non-temporal stores
+    auto size = mmser::lastLevelCacheSize() + 123;
+    auto src = std::vector<char>(size + 64);
+    for (size_t i{0}; i < src.size(); ++i) {
+        src[i] = static_cast<char>(i * 31 + 7);
+    }
+    for (size_t offset : {0, 1, 13}) {
+        auto dst = std::vector<char>(size + 64);
+        mmser::copyBytes(dst.data() + offset, src.data() + 3, size);
+        if (offset > 0) CHECK(dst[offset - 1] == 0);
+        CHECK(std::memcmp(dst.data() + offset, src.data() + 3, size) == 0);
+        CHECK(dst[offset + size] == 0);
+    }
+
+    { // mutable access copies a mapped vector in bulk
+        auto buffer = std::array<char, 14>{6, 0, 0, 0, 0, 0, 0, 0, 1, 0, 5, 0, 6, 0};
+        mmser::vector<int16_t> v;
+        mmser::loadMMap(buffer, v);
+        v[1] = 7;
+        CHECK(v.owningBuffer.size() == 3);
+        CHECK(v[0] == 1);
+        CHECK(v[1] == 7);
+        CHECK(v[2] == 6);
+        CHECK(buffer[10] == 5);
+    }
+}
+
+TEST_CASE("Tests mmser - thread pool", "[mmser][parallel]") {
+    auto pool = mmser::ThreadPool{4};
+    CHECK(pool.size() == 4);
+
+    auto hits = std::vector<std::atomic<size_t>>(1000);
+    for (size_t run{0}; run < 10; ++run) {
+        pool.parallel_for(hits.size(), [&](size_t i) {
+            hits[i] += 1;
+        });
+    }
+    for (auto const& h : hits) {
+        CHECK(h == 10);
+    }
+
+    CHECK_THROWS(pool.parallel_for(10, [](size_t i) {
+        if (i == 5) throw std::runtime_error{"error"};
+    }));
+}
+
+TEST_CASE("Tests mmser - parallel save", "[mmser][parallel][save]") {
+    auto input = std::tuple<std::vector<mmser::vector<int32_t>>, std::string, mmser::vector<uint64_t>>{};
+    for (size_t i{0}; i < 100; ++i) {
+        std::get<0>(input).emplace_back(i * 50, static_cast<int32_t>(i));
+    }
+    std::get<1>(input) = "separator";
+    std::get<2>(input).resize(100'000, 7);
+
+    auto size = mmser::computeSaveSize(input);
+    auto expected = std::vector<char>(size);
+    mmser::save(expected, input);
+
+    auto pool = mmser::ThreadPool{4};
+    { // small thresholds, so most payloads are deferred and split into pieces
+        auto buffer = std::vector<char>(size);
+        auto archive = mmser::ArchiveSaveParallel{buffer};
+        archive.threshold = 64;
+        archive.pieceSize = 1000;
+        handle(archive, input);
+        CHECK(archive.payloads.size() > 1);
+        archive.run(pool);
+        CHECK(archive.totalSize == size);
+        CHECK(buffer == expected);
+    }
+    { // default thresholds
+        auto buffer = std::vector<char>(size);
+        mmser::save(buffer, input, pool);
+        CHECK(buffer == expected);
+    }
+#ifdef MMSER_MMAP
+    {
+        auto filename = std::filesystem::temp_directory_path() / std::filesystem::path{"unit_test_mmser_save_parallel"};
+        mmser::saveFileMMap(filename, input, pool);
+        auto file = std::ifstream{filename, std::ios::binary};
+        auto content = std::vector<char>(std::istreambuf_iterator<char>{file}, {});
+        CHECK(content == expected);
+    }
+#endif
+}
+
+TEST_CASE("Tests mmser - parallel load", "[mmser][parallel][load]") {
+    auto input = std::tuple<std::vector<mmser::vector<int32_t>>, std::string, mmser::vector<uint64_t>>{};
+    for (size_t i{0}; i < 100; ++i) {
+        std::get<0>(input).emplace_back(i * 50, static_cast<int32_t>(i));
+    }
+    std::get<1>(input) = "separator";
+    std::get<2>(input).resize(100'000);
+    for (size_t i{0}; i < std::get<2>(input).size(); ++i) {
+        std::get<2>(input)[i] = i * 3;
+    }
+
+    auto check = [&](auto const& output) {
+        REQUIRE(std::get<0>(output).size() == std::get<0>(input).size());
+        for (size_t i{0}; i < std::get<0>(input).size(); ++i) {
+            auto const& a = std::get<0>(output)[i];
+            REQUIRE(a.size() == std::get<0>(input)[i].size());
+            CHECK(std::ranges::equal(a.view, std::get<0>(input)[i].view));
+            CHECK(a.view.data() == a.owningBuffer.data());
+        }
+        CHECK(std::get<1>(output) == "separator");
+        CHECK(std::ranges::equal(std::get<2>(output).view, std::get<2>(input).view));
+    };
+
+    auto size = mmser::computeSaveSize(input);
+    auto buffer = std::vector<char>(size);
+    mmser::save(buffer, input);
+
+    auto pool = mmser::ThreadPool{4};
+    { // small thresholds, so most payloads are split into pieces
+        auto output = decltype(input){};
+        auto archive = mmser::ArchiveLoadParallel{buffer, pool};
+        archive.threshold = 64;
+        archive.pieceSize = 1000;
+        handle(archive, output);
+        CHECK(archive.totalSize == size);
+        check(output);
+    }
+    {
+        auto filename = std::filesystem::temp_directory_path() / std::filesystem::path{"unit_test_mmser_load_parallel"};
+        mmser::saveFile(filename, input);
+        auto [output, storageManager] = mmser::loadFileCopy<decltype(input)>(filename, pool);
+        check(output);
+    }
+}
+
+TEST_CASE("Tests mmser - ragged_vector", "[mmser][ragged_vector]") {
+    mmser::ragged_vector<uint32_t> v;
+    CHECK(v.size() == 0);
+
+    v.push_back(std::vector<uint32_t>{1, 2, 3});
+    v.emplace_back();
+    v.emplace_back();
+    v.push_back_inner(4);
+    v.push_back_inner(5);
+    v.push_back(std::vector<uint32_t>{6});
+
+    auto check = [](mmser::ragged_vector<uint32_t> const& v) {
+        REQUIRE(v.size() == 4);
+        CHECK(v.valueCount() == 6);
+        CHECK(std::ranges::equal(v[0], std::vector<uint32_t>{1, 2, 3}));
+        CHECK(v[1].empty());
+        CHECK(std::ranges::equal(v[2], std::vector<uint32_t>{4, 5}));
+        CHECK(std::ranges::equal(v[3], std::vector<uint32_t>{6}));
+    };
+    check(v);
+
+    // 8 bytes size + 5*8 offsets, 8 bytes size + 6*4 values
+    CHECK(mmser::computeSaveSize(v) == 80);
+
+    auto buffer = std::vector<char>(mmser::computeSaveSize(v));
+    mmser::save(buffer, v);
+    { // check load
+        mmser::ragged_vector<uint32_t> v;
+        mmser::load(buffer, v);
+        CHECK(v.values.owningBuffer.size() == 6);
+        check(v);
+    }
+    { // check load via mmap, no copies
+        mmser::ragged_vector<uint32_t> v;
+        mmser::loadMMap(buffer, v);
+        CHECK(v.offsets.owningBuffer.size() == 0);
+        CHECK(v.values.owningBuffer.size() == 0);
+        CHECK(reinterpret_cast<char const*>(v[0].data()) == buffer.data() + 56);
+        check(v);
+
+        // modifying a mapped ragged vector copies it
+        v.push_back_inner(7);
+        CHECK(std::ranges::equal(v[3], std::vector<uint32_t>{6, 7}));
+    }
+
+    v.clear();
+    CHECK(v.size() == 0);
+    CHECK(v.valueCount() == 0);
+}
+
+TEST_CASE("Tests mmser - string", "[mmser][string]") {
+    mmser::string v{"hello world!"};
+    CHECK(v == "hello world!");
+    CHECK(v.size() == 12);
+
+    // same layout as std::string
+    auto s = mmser::computeSaveSize(v);
+    CHECK(s == 20);
+    auto buffer = std::array<char, 20>{12, 0, 0, 0, 0, 0, 0, 0, 'h', 'e', 'l', 'l', 'o', ' ', 'w', 'o', 'r', 'l', 'd', '!'};
+    { // check load
+        mmser::string v;
+        mmser::load(buffer, v);
+        CHECK(v == "hello world!");
+        CHECK(v.owningBuffer.size() == 12);
+    }
+    { // check load via mmap
+        mmser::string v;
+        mmser::loadMMap(buffer, v);
+        CHECK(v == "hello world!");
+        CHECK(v.owningBuffer.size() == 0);
+        CHECK(v.data() == buffer.data() + 8);
+    }
+    { // check save
+        auto output = std::array<char, 20>{};
+        mmser::save(output, v);
+        CHECK(output == buffer);
+
+        std::string v2;
+        mmser::load(output, v2);
+        CHECK(v2 == "hello world!");
+    }
+}
+
+TEST_CASE("Tests mmser - string_table", "[mmser][string_table]") {
+    mmser::string_table v;
+    v.push_back("hello");
+    v.push_back("");
+    v.push_back("world");
+
+    auto check = [](mmser::string_table const& v) {
+        REQUIRE(v.size() == 3);
+        CHECK(v[0] == "hello");
+        CHECK(v[1] == "");
+        CHECK(v[2] == "world");
+    };
+    check(v);
+
+    auto buffer = std::vector<char>(mmser::computeSaveSize(v));
+    mmser::save(buffer, v);
+    { // check load
+        mmser::string_table v;
+        mmser::load(buffer, v);
+        check(v);
+    }
+    { // check load via mmap, strings point into the buffer
+        mmser::string_table v;
+        mmser::loadMMap(buffer, v);
+        check(v);
+        CHECK(v[0].data() >= buffer.data());
+        CHECK(v[2].data() < buffer.data() + buffer.size());
+    }
+}
+
+TEST_CASE("Tests mmser - hash_map", "[mmser][hash_map]") {
+    mmser::hash_map<uint64_t, uint32_t> m;
+    CHECK(m.empty());
+    CHECK(m.find(5) == nullptr);
+
+    for (uint64_t i{0}; i < 1000; ++i) {
+        CHECK(m.insert(i * 3, static_cast<uint32_t>(i)));
+    }
+    CHECK(!m.insert(3, 7));
+    CHECK(m.size() == 1000);
+    m.insert_or_assign(3, 7);
+    CHECK(*m.find(3) == 7);
+    for (uint64_t i{0}; i < 1000; i += 2) {
+        CHECK(m.erase(i * 3));
+    }
+    CHECK(!m.erase(0));
+    CHECK(m.size() == 500);
+
+    auto check = [](mmser::hash_map<uint64_t, uint32_t> const& m) {
+        REQUIRE(m.size() == 500);
+        for (uint64_t i{1}; i < 1000; i += 2) {
+            REQUIRE(m.find(i * 3) != nullptr);
+            CHECK(*m.find(i * 3) == (i == 1 ? 7 : i));
+            CHECK(!m.contains(i * 3 + 3));
+        }
+        size_t count{};
+        m.forEach([&](uint64_t, uint32_t) { count += 1; });
+        CHECK(count == 500);
+    };
+    check(m);
+
+    { // padding and unused slots are zero, saved files are deterministic
+        using slot = mmser::hash_map<uint64_t, uint32_t>::slot;
+        auto isZero = [](unsigned char const* first, unsigned char const* last) {
+            return std::all_of(first, last, [](unsigned char c) { return c == 0; });
+        };
+        for (auto const& s : m.slots.view) {
+            auto bytes = reinterpret_cast<unsigned char const*>(&s);
+            CHECK(isZero(bytes + offsetof(slot, value) + sizeof(uint32_t), bytes + sizeof(slot)));
+        }
+        mmser::hash_map<uint64_t, uint32_t> single;
+        single.insert(5, 6);
+        size_t zeroSlots{};
+        for (auto const& s : single.slots.view) {
+            auto bytes = reinterpret_cast<unsigned char const*>(&s);
+            zeroSlots += isZero(bytes, bytes + sizeof(slot));
+        }
+        CHECK(zeroSlots == single.capacity() - 1);
+    }
+
+    auto buffer = std::vector<char>(mmser::computeSaveSize(m));
+    mmser::save(buffer, m);
+    { // check load
+        mmser::hash_map<uint64_t, uint32_t> m;
+        mmser::load(buffer, m);
+        check(m);
+    }
+    { // check load via mmap, lookups are served from the buffer
+        mmser::hash_map<uint64_t, uint32_t> m;
+        mmser::loadMMap(buffer, m);
+        check(m);
+        CHECK(m.groups.owningBuffer.size() == 0);
+        CHECK(m.slots.owningBuffer.size() == 0);
+
+        // modifications copy the table
+        m.insert_or_assign(9, 1);
+        CHECK(*m.find(9) == 1);
+        CHECK(m.slots.owningBuffer.size() > 0);
+        m.insert(0, 2);
+        CHECK(*m.find(0) == 2);
+        CHECK(m.size() == 501);
+    }
+#ifdef MMSER_MMAP
+    { // in a writable mapping only value updates change the file, inserting and erasing copies the table
+        using Map = mmser::hash_map<uint64_t, uint32_t>;
+        auto filename = std::filesystem::temp_directory_path() / std::filesystem::path{"unit_test_mmser_hash_map_writable"};
+        auto input = Map{};
+        for (uint64_t i{0}; i < 10; ++i) {
+            input.insert(i, static_cast<uint32_t>(i));
+        }
+        mmser::saveFile(filename, input);
+
+        auto countElements = [](Map const& m) {
+            size_t count{};
+            m.forEach([&](uint64_t, uint32_t) { count += 1; });
+            return count;
+        };
+        {
+            auto [m, storage] = mmser::loadFileMMapWritable<Map>(filename);
+            m.insert_or_assign(3, 30);
+            CHECK(m.slots.owningBuffer.empty());
+            for (uint64_t i{100}; i < 105; ++i) {
+                m.insert(i, 1);
+            }
+            CHECK(m.erase(4));
+            CHECK(m.size() == 14);
+            CHECK(countElements(m) == 14);
+            mmser::flush(storage);
+        }
+        auto [m, storage] = mmser::loadFileMMap<Map>(filename);
+        CHECK(m.size() == 10);
+        CHECK(countElements(m) == 10);
+        CHECK(*m.find(3) == 30);
+        CHECK(m.contains(4));
+        CHECK(!m.contains(100));
+    }
+#endif
+}
+
+TEST_CASE("Tests mmser - perfect_hash", "[mmser][perfect_hash]") {
+    auto keys = std::vector<uint64_t>{};
+    for (uint64_t i{0}; i < 10'000; ++i) {
+        keys.push_back(i * i * 31 + 7);
+    }
+    auto ph = mmser::perfect_hash<uint64_t>{keys};
+    CHECK(ph.size() == keys.size());
+
+    // every key gets its own index in [0, n)
+    auto check = [&](mmser::perfect_hash<uint64_t> const& ph) {
+        auto seen = std::vector<bool>(keys.size(), false);
+        for (auto k : keys) {
+            auto idx = ph(k);
+            REQUIRE(idx < keys.size());
+            CHECK(!seen[idx]);
+            seen[idx] = true;
+        }
+    };
+    check(ph);
+
+    auto buffer = std::vector<char>(mmser::computeSaveSize(ph));
+    mmser::save(buffer, ph);
+    { // check load
+        mmser::perfect_hash<uint64_t> ph2;
+        mmser::load(buffer, ph2);
+        check(ph2);
+    }
+    { // check load via mmap, values are paired via a mmser::vector
+        mmser::perfect_hash<uint64_t> ph2;
+        mmser::loadMMap(buffer, ph2);
+        CHECK(ph2.pilots.owningBuffer.size() == 0);
+        check(ph2);
+
+        auto values = mmser::vector<uint64_t>(keys.size());
+        for (auto k : keys) {
+            values[ph2(k)] = k + 1;
+        }
+        for (auto k : keys) {
+            CHECK(values[ph2(k)] == k + 1);
+        }
+    }
+
+    // duplicate keys can not be hashed perfectly
+    CHECK_THROWS(mmser::perfect_hash<uint64_t>{std::vector<uint64_t>{1, 2, 1}});
+}
+
+template <typename TestType>
+void checkStaticSearchTree() {
+    for (size_t n : {0, 1, 7, 8, 9, 16, 17, 100, 1000, 5000}) {
+        auto sorted = std::vector<TestType>{};
+        for (size_t i{0}; i < n; ++i) {
+            sorted.push_back(static_cast<TestType>(i * 3 - n)); // negative values for signed types
+        }
+        std::ranges::sort(sorted);
+        auto tree = mmser::static_search_tree<TestType>{sorted};
+        CHECK(tree.size() == n);
+
+        auto check = [&](mmser::static_search_tree<TestType> const& tree) {
+            for (size_t i{0}; i < n; ++i) {
+                CHECK(tree[i] == sorted[i]);
+                CHECK(tree.contains(sorted[i]));
+            }
+            auto queries = std::vector<TestType>{0, 1, 2, std::numeric_limits<TestType>::min(), std::numeric_limits<TestType>::max()};
+            for (auto v : sorted) {
+                queries.push_back(v - 1);
+                queries.push_back(v);
+                queries.push_back(v + 1);
+            }
+            for (auto q : queries) {
+                auto expected = std::ranges::lower_bound(sorted, q) - sorted.begin();
+                CHECK(tree.lower_bound(q) == static_cast<size_t>(expected));
+            }
+        };
+        check(tree);
+
+        auto buffer = std::vector<char>(mmser::computeSaveSize(tree));
+        mmser::save(buffer, tree);
+        mmser::static_search_tree<TestType> tree2;
+        mmser::loadMMap(buffer, tree2);
+        CHECK(tree2.nodes.owningBuffer.size() == 0);
+        check(tree2);
+    }
+}
+
+TEST_CASE("Tests mmser - static_search_tree", "[mmser][static_search_tree]") {
+    checkStaticSearchTree<uint64_t>();
+    checkStaticSearchTree<uint32_t>();
+    checkStaticSearchTree<int32_t>();
+}
+
+TEST_CASE("Tests mmser - packed_vector", "[mmser][packed_vector]") {
+    SECTION("minimal width") {
+        auto values = std::vector<uint64_t>{5, 0, 1023, 7};
+        auto v = mmser::packed_vector{values};
+        CHECK(v.width() == 10);
+        CHECK(v.size() == 4);
+        CHECK(v[2] == 1023);
+        CHECK(mmser::packed_vector{std::vector<uint64_t>{0, 0}}.width() == 0);
+        CHECK(mmser::packed_vector::requiredBits(std::vector<uint64_t>{~uint64_t{0}}) == 64);
+    }
+
+    SECTION("all widths") {
+        for (size_t bits{0}; bits <= 64; ++bits) {
+            auto mask = bits == 0 ? 0 : ~uint64_t{0} >> (64 - bits);
+            auto values = std::vector<uint64_t>{};
+            for (size_t i{0}; i < 300; ++i) {
+                values.push_back(mmser::mix64(i) & mask);
+            }
+            auto v = mmser::packed_vector{values, bits};
+            auto v2 = mmser::packed_vector{bits};
+            for (auto x : values) {
+                v2.push_back(x);
+            }
+            for (size_t i{0}; i < values.size(); ++i) {
+                CHECK(v.get(i) == values[i]);
+                CHECK(v2.get(i) == values[i]);
+            }
+            // decode with unaligned head and tail
+            auto out = std::vector<uint64_t>(values.size() - 10);
+            v.decode(3, out);
+            CHECK(std::equal(out.begin(), out.end(), values.begin() + 3));
+
+            v.set(5, mask);
+            CHECK(v.get(4) == values[4]);
+            CHECK(v.get(5) == mask);
+            CHECK(v.get(6) == values[6]);
+        }
+    }
+
+    SECTION("save and load via mmap") {
+        auto v = mmser::packed_vector{34};
+        for (uint64_t i{0}; i < 1000; ++i) {
+            v.push_back(i * 1'000'003);
+        }
+        v.shrink_to_fit();
+        CHECK(v.width() == 30);
+
+        auto buffer = std::vector<char>(mmser::computeSaveSize(v));
+        mmser::save(buffer, v);
+        mmser::packed_vector v2;
+        mmser::loadMMap(buffer, v2);
+        CHECK(v2.words.owningBuffer.size() == 0);
+        REQUIRE(v2.size() == 1000);
+        for (uint64_t i{0}; i < 1000; ++i) {
+            CHECK(v2[i] == i * 1'000'003);
+        }
+    }
+}
+
+TEST_CASE("Tests mmser - bitvector", "[mmser][bitvector]") {
+    SECTION("select within a word") {
+        CHECK(mmser::selectInWord(0b1011'0000, 0) == 4);
+        CHECK(mmser::selectInWord(0b1011'0000, 2) == 7);
+        CHECK(mmser::selectInWord(~uint64_t{0}, 63) == 63);
+        CHECK(mmser::selectInWord(uint64_t{1} << 63 | 1, 1) == 63);
+    }
+
+    // bit i is set with probability 1/density
+    auto check = [](size_t n, uint64_t density) {
+        auto bv = mmser::bitvector{};
+        auto onesPos  = std::vector<size_t>{};
+        auto zerosPos = std::vector<size_t>{};
+        for (size_t i{0}; i < n; ++i) {
+            auto v = mmser::mix64(i * density + n) % density == 0;
+            bv.push_back(v);
+            (v ? onesPos : zerosPos).push_back(i);
+        }
+        bv.buildIndex();
+
+        auto verify = [&](mmser::bitvector const& bv) {
+            REQUIRE(bv.size() == n);
+            CHECK(bv.rank1(n) == onesPos.size());
+            size_t r{0};
+            for (size_t i{0}; i < n; ++i) {
+                CHECK(bv.rank1(i) == r);
+                CHECK(bv.rank0(i) == i - r);
+                r += bv[i];
+            }
+            for (size_t k{0}; k < onesPos.size(); ++k) {
+                CHECK(bv.select1(k) == onesPos[k]);
+            }
+            for (size_t k{0}; k < zerosPos.size(); ++k) {
+                CHECK(bv.select0(k) == zerosPos[k]);
+            }
+        };
+        verify(bv);
+
+        auto buffer = std::vector<char>(mmser::computeSaveSize(bv));
+        mmser::save(buffer, bv);
+        mmser::bitvector bv2;
+        mmser::loadMMap(buffer, bv2);
+        CHECK(bv2.bits.owningBuffer.size() == 0);
+        CHECK(bv2.blocks.owningBuffer.size() == 0);
+        verify(bv2);
+    };
+    for (size_t n : {0, 1, 63, 64, 65, 511, 512, 513, 10'000}) {
+        check(n, 2);
+    }
+    check(100'000, 1);   // all ones
+    check(100'000, 3);
+    check(100'000, 1000); // sparse
+    check(100'000, ~uint64_t{0}); // practically no ones
+
+    auto words = std::vector<uint64_t>{0xff00, ~uint64_t{0}};
+    auto bv = mmser::bitvector{words, 100};
+    CHECK(bv.rank1(100) == 8 + 36);
+    CHECK(bv.select1(8) == 64);
+    CHECK(mmser::bitvector(70, true).rank1(70) == 70);
+}
+
+TEST_CASE("Tests mmser - elias_fano", "[mmser][elias_fano]") {
+    auto check = [](std::vector<uint64_t> const& values) {
+        auto ef = mmser::elias_fano{values};
+
+        auto verify = [&](mmser::elias_fano const& ef) {
+            REQUIRE(ef.size() == values.size());
+            for (size_t i{0}; i < values.size(); ++i) {
+                CHECK(ef[i] == values[i]);
+            }
+            CHECK(std::ranges::equal(ef, values));
+            auto queries = std::vector<uint64_t>{0, 1, ~uint64_t{0}};
+            for (auto v : values) {
+                queries.push_back(v);
+                queries.push_back(v + 1);
+                if (v > 0) queries.push_back(v - 1);
+            }
+            for (auto q : queries) {
+                auto expected = std::ranges::lower_bound(values, q) - values.begin();
+                CHECK(ef.next_geq(q) == static_cast<size_t>(expected));
+            }
+        };
+        verify(ef);
+
+        auto buffer = std::vector<char>(mmser::computeSaveSize(ef));
+        mmser::save(buffer, ef);
+        mmser::elias_fano ef2;
+        mmser::loadMMap(buffer, ef2);
+        CHECK(ef2.lows.words.owningBuffer.size() == 0);
+        verify(ef2);
+        return buffer.size();
+    };
+
+    check({});
+    check({0});
+    check({5, 5, 5});
+    check({0, 1, 2, 3, 4, 5, 6, 7, 8});
+
+    // sparse, with duplicates
+    auto values = std::vector<uint64_t>{};
+    uint64_t v{};
+    for (size_t i{0}; i < 10'000; ++i) {
+        v += mmser::mix64(i) % 1000;
+        values.push_back(v);
+    }
+    auto bytes = check(values);
+    CHECK(bytes * 8 < values.size() * 16); // ~2 + log(1000/2) bits per value, plus directories
+
+    values.push_back(uint64_t{1} << 62);
+    check(values);
+}
+
+struct Particle {
+    double x{}, y{}, z{};
+    uint32_t id{};
+    bool operator==(Particle const&) const = default;
+};
+
+TEST_CASE("Tests mmser - soa_vector", "[mmser][soa_vector]") {
+    using Particles = mmser::soa_vector<Particle, &Particle::x, &Particle::y, &Particle::z, &Particle::id>;
+    Particles v;
+    for (uint32_t i{0}; i < 100; ++i) {
+        v.push_back({i * 1., i * 2., i * 3., i});
+    }
+    v.set(3, {-1., -2., -3., 7});
+
+    auto check = [](Particles const& v) {
+        REQUIRE(v.size() == 100);
+        CHECK(v[2] == Particle{2., 4., 6., 2});
+        CHECK(v[3] == Particle{-1., -2., -3., 7});
+        // a column is a contiguous span
+        auto ids = v.column<&Particle::id>();
+        CHECK(ids.size() == 100);
+        CHECK(ids[99] == 99);
+        CHECK(v.column<1>()[50] == 100.);
+        double sum{};
+        for (auto z : v.column<&Particle::z>()) {
+            sum += z;
+        }
+        CHECK(sum == 3. * (99 * 100 / 2 - 3) - 3.);
+    };
+    check(v);
+
+    auto buffer = std::vector<char>(mmser::computeSaveSize(v));
+    mmser::save(buffer, v);
+    { // check load
+        Particles v;
+        mmser::load(buffer, v);
+        check(v);
+    }
+    { // check load via mmap, columns point into the buffer
+        Particles v;
+        mmser::loadMMap(buffer, v);
+        check(v);
+        CHECK(std::get<0>(v.columns).owningBuffer.size() == 0);
+        CHECK(v.column<&Particle::x>().data() >= reinterpret_cast<double const*>(buffer.data()));
+    }
+}
+
+// not trivially copyable, because of the copy constructor
+struct Point3D {
+    float x{}, y{}, z{};
+    Point3D() = default;
+    Point3D(float _x, float _y, float _z) : x{_x}, y{_y}, z{_z} {}
+    Point3D(Point3D const& o) : x{o.x}, y{o.y}, z{o.z} {}
+    auto operator=(Point3D const& o) -> Point3D& = default;
+    bool operator==(Point3D const&) const = default;
+
+    template <typename Ar>
+    void serialize(this auto&& self, Ar& ar) {
+        ar(self.x, self.y, self.z);
+    }
+};
+template <>
+struct mmser::is_layout_compatible_t<Point3D> : std::true_type {};
+
+TEST_CASE("Tests mmser - layout compatible types", "[mmser][layout_compatible]") {
+    static_assert(!std::is_trivially_copyable_v<Point3D>);
+    static_assert(mmser::is_trivially_copyable<Point3D const>);
+
+    auto input = std::vector<Point3D>{{1, 2, 3}, {4, 5, 6}};
+    auto s = mmser::computeSaveSize(input);
+    CHECK(s == 8 + 2*sizeof(Point3D));
+
+    auto buffer = std::vector<char>(s);
+    mmser::save(buffer, input);
+    CHECK(std::memcmp(buffer.data() + 8, input.data(), 2*sizeof(Point3D)) == 0);
+
+    auto output = std::vector<Point3D>{};
+    mmser::load(buffer, output);
+    CHECK(output == input);
+
+    // single objects are a single blob as well
+    auto p = Point3D{7, 8, 9};
+    CHECK(mmser::computeSaveSize(p) == sizeof(Point3D));
+    auto buffer2 = std::vector<char>(sizeof(Point3D));
+    mmser::save(buffer2, p);
+    Point3D p2;
+    mmser::load(buffer2, p2);
+    CHECK(p2 == p);
+}
+
+struct Sample {
+    uint8_t  tag{};
+    uint32_t value{};
+    std::array<uint16_t, 3> extra{};
+
+    template <typename Ar>
+    void serialize(this auto&& self, Ar& ar) {
+        ar(self.tag, self.value, self.extra);
+    }
+};
+template <>
+struct mmser::static_save_size_t<Sample> : mmser::static_save_size_of<uint8_t, uint32_t, std::array<uint16_t, 3>> {};
+
+// size of t computed by the save path, which does not use static_save_size_t
+template <typename T>
+auto savedSize(T const& t) -> size_t {
+    auto buffer = std::vector<char>(1024);
+    auto archive = mmser::Archive<mmser::Mode::Save>{buffer};
+    handle(archive, t);
+    return archive.totalSize;
+}
+
+TEST_CASE("Tests mmser - static save size", "[mmser][static_save_size]") {
+    static_assert(mmser::static_save_size_t<uint32_t>::value == 4);
+    static_assert(mmser::static_save_size_t<std::tuple<uint8_t, uint32_t>>::value == 8);
+    static_assert(mmser::static_save_size_t<std::tuple<uint8_t, std::tuple<uint8_t, uint32_t>>>::value == 8);
+    static_assert(mmser::static_save_size_t<Sample>::value == 14);
+    static_assert(mmser::static_save_size_t<Sample>::alignment == 4);
+    static_assert(!mmser::has_static_save_size<std::vector<int>>);
+    static_assert(!mmser::has_static_save_size<std::tuple<int, std::string>>);
+
+    auto check = [](auto const& t) {
+        CHECK(mmser::computeSaveSize(t) == savedSize(t));
+    };
+    check(std::tuple<uint8_t, std::tuple<uint8_t, uint32_t>>{});
+    check(std::tuple<uint8_t, std::array<std::tuple<uint8_t, uint32_t>, 3>>{});
+    check(std::vector<std::tuple<uint8_t, uint32_t>>(10));
+    check(std::vector<std::tuple<uint32_t, uint8_t>>(10)); // 5 bytes per element, not a multiple of the alignment
+    check(std::vector<Sample>(10));
+    check(std::tuple<uint8_t, std::array<std::tuple<uint16_t, uint8_t>, 5>>{});
+    check(std::tuple<std::vector<std::tuple<uint8_t, uint64_t>>, uint8_t, std::vector<Sample>>{{{}, {}}, {}, {{}, {}, {}}});
+}
+
+#ifdef MMSER_MMAP
+TEST_CASE("Tests mmser - single pass save", "[mmser][save][growing]") {
+    auto input = std::tuple<std::vector<mmser::vector<int32_t>>, std::string, mmser::vector<uint64_t>>{};
+    for (size_t i{0}; i < 100; ++i) {
+        std::get<0>(input).emplace_back(i * 50, static_cast<int32_t>(i));
+    }
+    std::get<1>(input) = "separator";
+    std::get<2>(input).resize(100'000, 7);
+
+    auto expected = std::vector<char>(mmser::computeSaveSize(input));
+    mmser::save(expected, input);
+
+    auto filename = std::filesystem::temp_directory_path() / std::filesystem::path{"unit_test_mmser_save_growing"};
+    auto readFile = [&]() {
+        auto file = std::ifstream{filename, std::ios::binary};
+        return std::vector<char>(std::istreambuf_iterator<char>{file}, {});
+    };
+    { // tiny initial capacity, the mapping grows many times
+        auto archive = mmser::ArchiveSaveGrowing{filename, 16};
+        handle(archive, input);
+        CHECK(archive.capacity >= expected.size());
+        archive.close();
+        CHECK(readFile() == expected);
+    }
+    {
+        mmser::saveFileGrowing(filename, input);
+        CHECK(readFile() == expected);
+        auto [output, storage] = mmser::loadFileMMap<decltype(input)>(filename);
+        CHECK(std::get<1>(output) == "separator");
+        CHECK(std::get<2>(output)[99'999] == 7);
+    }
+    { // empty
+        mmser::saveFileGrowing(filename, std::tuple<>{});
+        CHECK(std::filesystem::file_size(filename) == 0);
+    }
+}
+#endif
+
+#ifdef MMSER_MMAP
+TEST_CASE("Tests mmser - gather save", "[mmser][save][gather]") {
+    auto input = std::tuple<std::vector<mmser::vector<int32_t>>, std::string, mmser::vector<uint64_t>>{};
+    for (size_t i{0}; i < 3000; ++i) {
+        std::get<0>(input).emplace_back(i % 200, static_cast<int32_t>(i));
+    }
+    std::get<1>(input) = "separator";
+    std::get<2>(input).resize(100'000, 7);
+
+    auto expected = std::vector<char>(mmser::computeSaveSize(input));
+    mmser::save(expected, input);
+
+    auto filename = std::filesystem::temp_directory_path() / std::filesystem::path{"unit_test_mmser_save_gather"};
+    auto readFile = [&]() {
+        auto file = std::ifstream{filename, std::ios::binary};
+        return std::vector<char>(std::istreambuf_iterator<char>{file}, {});
+    };
+    { // small threshold, many referenced payloads and several flushes
+        auto archive = mmser::ArchiveSaveGather{filename};
+        archive.threshold = 64;
+        handle(archive, input);
+        archive.close();
+        CHECK(readFile() == expected);
+    }
+    {
+        mmser::saveFileGather(filename, input);
+        CHECK(readFile() == expected);
+    }
+    { // more than IOV_MAX referenced payloads before the first inline one
+        auto values = std::vector<uint64_t>(2000);
+        for (size_t i{0}; i < values.size(); ++i) {
+            values[i] = i;
+        }
+        auto archive = mmser::ArchiveSaveGather{filename};
+        archive.threshold = 8;
+        for (auto const& v : values) {
+            archive.save({reinterpret_cast<char const*>(&v), sizeof(v)});
+        }
+        archive.save(std::span{"end", 3});
+        archive.close();
+
+        auto expected = std::vector<char>(reinterpret_cast<char const*>(values.data()), reinterpret_cast<char const*>(values.data() + values.size()));
+        expected.insert(expected.end(), {'e', 'n', 'd'});
+        CHECK(readFile() == expected);
+    }
+}
+#endif
+
+#ifdef MMSER_MMAP
+TEST_CASE("Tests mmser - buffered stream", "[mmser][save][load][stream]") {
+    auto input = std::tuple<std::vector<mmser::vector<int32_t>>, std::string, mmser::vector<uint64_t>, std::vector<std::string>>{};
+    for (size_t i{0}; i < 500; ++i) {
+        std::get<0>(input).emplace_back(i % 50, static_cast<int32_t>(i));
+    }
+    std::get<1>(input) = "separator";
+    std::get<2>(input).resize(10'000, 7);
+    std::get<3>(input) = {"a", "", "bc"};
+
+    auto expected = std::vector<char>(mmser::computeSaveSize(input));
+    mmser::save(expected, input);
+
+    auto filename = std::filesystem::temp_directory_path() / std::filesystem::path{"unit_test_mmser_stream"};
+    auto readFile = [&]() {
+        auto file = std::ifstream{filename, std::ios::binary};
+        return std::vector<char>(std::istreambuf_iterator<char>{file}, {});
+    };
+    for (size_t bufferSize : {1, 7, 64, 4096, 1<<20}) {
+        {
+            auto archive = mmser::ArchiveSaveStream{filename, bufferSize};
+            handle(archive, input);
+            archive.close();
+            CHECK(readFile() == expected);
+        }
+        {
+            auto output = decltype(input){};
+            auto archive = mmser::ArchiveLoadStream{filename, bufferSize};
+            handle(archive, output);
+            CHECK(archive.totalSize == expected.size());
+            REQUIRE(std::get<0>(output).size() == 500);
+            CHECK(std::get<0>(output)[499].size() == 49);
+            CHECK(std::get<0>(output)[499][48] == 499);
+            CHECK(std::get<1>(output) == "separator");
+            CHECK(std::get<2>(output)[9'999] == 7);
+            CHECK(std::get<3>(output) == std::get<3>(input));
+        }
+    }
+    { // destructor writes the remaining buffer
+        {
+            auto archive = mmser::ArchiveSaveStream{filename};
+            handle(archive, input);
+        }
+        CHECK(readFile() == expected);
+    }
+    { // truncated file
+        std::filesystem::resize_file(filename, expected.size() / 2);
+        CHECK_THROWS(mmser::loadFileStream<decltype(input)>(filename));
+    }
+}
+#endif
+
+TEST_CASE("Tests mmser - load into caller storage", "[mmser][load][loadInto]") {
+    auto input = std::tuple<uint8_t, mmser::vector<int32_t>>{3, {1, 2, 3, 4, 5}};
+    auto expected = std::vector<char>(mmser::computeSaveSize(input));
+    mmser::save(expected, input);
+
+    auto check = [&](auto& archive) {
+        uint8_t first{};
+        auto output = std::vector<int32_t>{};
+        archive & first;
+        archive.loadInto(alignof(int32_t), [&](size_t size) {
+            output.resize(size / sizeof(int32_t));
+            return std::span{reinterpret_cast<char*>(output.data()), size};
+        });
+        CHECK(first == 3);
+        CHECK(output == std::vector<int32_t>{1, 2, 3, 4, 5});
+        CHECK(archive.totalSize == expected.size());
+    };
+    {
+        auto archive = mmser::Archive<mmser::Mode::Load>{expected};
+        check(archive);
+    }
+    {
+        auto filename = std::filesystem::temp_directory_path() / std::filesystem::path{"unit_test_mmser_load_into"};
+        mmser::saveFileStream(filename, input);
+        auto archive = mmser::ArchiveLoadStream{filename};
+        check(archive);
+    }
+}
+
+#ifdef MMSER_MMAP
+TEST_CASE("Tests mmser - copy-on-write of mapped vectors", "[mmser][vector][mmap][cow]") {
+    auto input = std::tuple<std::string, mmser::vector<uint32_t>>{"header", {}};
+    std::get<1>(input).resize(100'000, 1);
+
+    auto filename = std::filesystem::temp_directory_path() / std::filesystem::path{"unit_test_mmser_cow"};
+    mmser::saveFile(filename, input);
+
+    auto [output, storage] = mmser::loadFileMMap<decltype(input)>(filename);
+    auto& v = std::get<1>(output);
+    auto file = mmser::mappedFile(storage);
+    REQUIRE(file != nullptr);
+    auto inMapping = [&]() {
+        auto p = reinterpret_cast<char const*>(v.view.data());
+        return p >= file->data() && p < file->data() + file->size();
+    };
+
+    CHECK(v.mapping() == mmser::vector<uint32_t>::Mapping::Private);
+    v[50'000] = 2;
+    v.back() = 3;
+    CHECK(v.mapping() == mmser::vector<uint32_t>::Mapping::Writable);
+    CHECK(v.owningBuffer.empty());
+    CHECK(inMapping());
+    CHECK(v[50'000] == 2);
+    CHECK(v[49'999] == 1);
+
+    auto ranges = std::vector<std::tuple<size_t, size_t>>{};
+    v.forEachDirtyRange([&](size_t offset, size_t length) {
+        ranges.emplace_back(offset, length);
+    });
+    REQUIRE(ranges.size() == 2);
+    CHECK(std::get<0>(ranges[0]) == 50'000 * 4 / 4096 * 4096);
+    CHECK(std::get<1>(ranges[0]) == 4096);
+    CHECK(std::get<0>(ranges[1]) + std::get<1>(ranges[1]) == 400'000);
+
+    { // the file is unchanged
+        auto [reloaded, storage2] = mmser::loadFileCopy<decltype(input)>(filename);
+        CHECK(std::get<1>(reloaded)[50'000] == 1);
+    }
+    mmser::writeBack(filename, storage, v);
+    {
+        auto [reloaded, storage2] = mmser::loadFileCopy<decltype(input)>(filename);
+        CHECK(std::get<0>(reloaded) == "header");
+        CHECK(std::get<1>(reloaded)[50'000] == 2);
+        CHECK(std::get<1>(reloaded)[49'999] == 1);
+        CHECK(std::get<1>(reloaded).back() == 3);
+    }
+    size_t dirty{};
+    v.forEachDirtyRange([&](size_t, size_t) { ++dirty; });
+    CHECK(dirty == 0);
+
+    { // after the first mutable access, threads may write different elements
+        auto pool = mmser::ThreadPool{4};
+        pool.parallel_for(4096, [&](size_t i) {
+            v[i * 4] = 5;
+        });
+        ranges.clear();
+        v.forEachDirtyRange([&](size_t offset, size_t length) {
+            ranges.emplace_back(offset, length);
+        });
+        REQUIRE(ranges.size() == 1);
+        CHECK(ranges[0] == std::tuple<size_t, size_t>{0, 4096 * 4 * 4});
+        CHECK(v[4 * 4095] == 5);
+    }
+
+    // changing the size copies the view
+    v.push_back(4);
+    CHECK(v.mapping() == mmser::vector<uint32_t>::Mapping::None);
+    CHECK(v.size() == 100'001);
+    CHECK(v[50'000] == 2);
+    CHECK(!inMapping());
+}
+#endif
+
+#ifdef MMSER_MMAP
+TEST_CASE("Tests mmser - writable shared mapping", "[mmser][vector][mmap][writable]") {
+    auto input = std::tuple<std::string, mmser::vector<uint32_t>, mmser::packed_vector>{"header", {}, mmser::packed_vector{5}};
+    std::get<1>(input).resize(10'000, 1);
+    for (size_t i{0}; i < 100; ++i) {
+        std::get<2>(input).push_back(i % 32);
+    }
+
+    auto filename = std::filesystem::temp_directory_path() / std::filesystem::path{"unit_test_mmser_writable"};
+    mmser::saveFile(filename, input);
+    auto fileSize = std::filesystem::file_size(filename);
+
+    {
+        auto [output, storage] = mmser::loadFileMMapWritable<decltype(input)>(filename);
+        auto& [header, v, packed] = output;
+        CHECK(header == "header");
+        CHECK(v.mapping() == mmser::vector<uint32_t>::Mapping::Shared);
+        v[5'000] = 2;
+        v.back() = 3;
+        packed.set(7, 31);
+        CHECK(v.owningBuffer.empty());
+        CHECK(packed.words.owningBuffer.empty());
+
+        // visible through another mapping before flushing
+        auto [other, storage2] = mmser::loadFileMMap<decltype(input)>(filename);
+        CHECK(std::get<1>(other)[5'000] == 2);
+        mmser::flush(storage);
+    }
+    CHECK(std::filesystem::file_size(filename) == fileSize);
+    auto [reloaded, storage] = mmser::loadFileCopy<decltype(input)>(filename);
+    CHECK(std::get<0>(reloaded) == "header");
+    CHECK(std::get<1>(reloaded)[4'999] == 1);
+    CHECK(std::get<1>(reloaded)[5'000] == 2);
+    CHECK(std::get<1>(reloaded).back() == 3);
+    CHECK(std::get<2>(reloaded).get(6) == 6);
+    CHECK(std::get<2>(reloaded).get(7) == 31);
+    CHECK(std::get<2>(reloaded).get(8) == 8);
+
+    { // bitvector::set copies the bits, the saved rank and select directories would not match them
+        auto bvFilename = std::filesystem::temp_directory_path() / std::filesystem::path{"unit_test_mmser_writable_bitvector"};
+        mmser::saveFile(bvFilename, mmser::bitvector{1000, false});
+        {
+            auto [bv, storage] = mmser::loadFileMMapWritable<mmser::bitvector>(bvFilename);
+            bv.set(10, true);
+            CHECK(!bv.bits.owningBuffer.empty());
+            bv.buildIndex();
+            CHECK(bv.rank1(11) == 1);
+            mmser::flush(storage);
+        }
+        auto [bv, storage] = mmser::loadFileMMap<mmser::bitvector>(bvFilename);
+        CHECK(!bv[10]);
+        CHECK(bv.rank1(1000) == 0);
+        CHECK(bv.select0(10) == 10);
+    }
+
+    { // ragged_vector::push_back_inner copies both arrays, the file keeps matching offsets and values
+        auto rvFilename = std::filesystem::temp_directory_path() / std::filesystem::path{"unit_test_mmser_writable_ragged_vector"};
+        auto rv = mmser::ragged_vector<int32_t>{};
+        rv.push_back(std::vector<int32_t>{1, 2});
+        rv.push_back(std::vector<int32_t>{3, 4, 5});
+        mmser::saveFile(rvFilename, rv);
+        {
+            auto [mapped, storage] = mmser::loadFileMMapWritable<mmser::ragged_vector<int32_t>>(rvFilename);
+            mapped.push_back_inner(6);
+            CHECK(mapped.back().size() == 4);
+            CHECK(mapped.offsets.owningBuffer.size() == 3);
+            mmser::flush(storage);
+        }
+        auto [reloaded, storage] = mmser::loadFileMMap<mmser::ragged_vector<int32_t>>(rvFilename);
+        REQUIRE(reloaded.size() == 2);
+        CHECK(reloaded.valueCount() == 5);
+        CHECK(reloaded.offsets.view.back() == 5);
+        CHECK(std::ranges::equal(reloaded.back(), std::vector<int32_t>{3, 4, 5}));
+    }
+}
+#endif
+
+#ifdef MMSER_MMAP
+TEST_CASE("Tests mmser - file backed vector", "[mmser][file_vector]") {
+    auto scratch = std::filesystem::temp_directory_path() / std::filesystem::path{"unit_test_mmser_file_vector_scratch"};
+    auto target  = std::filesystem::temp_directory_path() / std::filesystem::path{"unit_test_mmser_file_vector"};
+
+    SECTION("vector only") {
+        auto v = mmser::file_vector<uint64_t>{scratch, 0, 16};
+        for (size_t i{0}; i < 100'000; ++i) {
+            v.push_back(i * 3);
+        }
+        CHECK(v.size() == 100'000);
+        CHECK(v[99'999] == 299'997);
+        v.finalize(target);
+        CHECK(!std::filesystem::exists(scratch));
+
+        auto [output, storage] = mmser::loadFileMMap<mmser::vector<uint64_t>>(target);
+        REQUIRE(output.size() == 100'000);
+        CHECK(output[0] == 0);
+        CHECK(output[99'999] == 299'997);
+    }
+    SECTION("with prefix and over aligned elements") {
+        struct alignas(16) Wide {
+            uint64_t a, b;
+        };
+        auto header = std::tuple<uint8_t, std::string>{7, "events"};
+        auto v = mmser::file_vector<Wide>{scratch, mmser::computeSaveSize(header)};
+        v.resize(10);
+        v.emplace_back(Wide{1, 2});
+        v.resize(5, Wide{3, 4});
+        v.resize(8);
+        CHECK(v[7].a == 0);
+        v.finalize(target, header);
+
+        auto [output, storage] = mmser::loadFileMMap<std::tuple<uint8_t, std::string, mmser::vector<Wide>>>(target);
+        CHECK(std::get<0>(output) == 7);
+        CHECK(std::get<1>(output) == "events");
+        REQUIRE(std::get<2>(output).size() == 8);
+        CHECK(std::get<2>(output)[4].a == 0);
+        CHECK(std::get<2>(output)[7].b == 0);
+        CHECK(std::filesystem::file_size(target) == mmser::computeSaveSize(output));
+    }
+    SECTION("scratch file is removed") {
+        {
+            auto v = mmser::file_vector<uint32_t>{scratch};
+            v.push_back(1);
+            CHECK(std::filesystem::exists(scratch));
+        }
+        CHECK(!std::filesystem::exists(scratch));
+
+        // also if finalize fails, here because the prefix does not fit
+        auto v = mmser::file_vector<uint32_t>{scratch, 4};
+        v.push_back(1);
+        CHECK_THROWS(v.finalize(target, uint8_t{7}));
+        CHECK(!std::filesystem::exists(scratch));
+    }
+}
+#endif
+
+#ifdef MMSER_MMAP
+TEST_CASE("Tests mmser - append to trailing vector", "[mmser][append]") {
+    using Log = std::tuple<std::string, mmser::vector<uint32_t>>;
+    auto filename = std::filesystem::temp_directory_path() / std::filesystem::path{"unit_test_mmser_append"};
+    mmser::saveFile(filename, Log{"events", {1, 2, 3}});
+
+    auto [old, oldStorage] = mmser::loadFileMMap<Log>(filename);
+
+    mmser::appendFile<Log>(filename, std::vector<uint32_t>{4, 5});
+    mmser::appendFile<Log>(filename, std::array<uint32_t, 1>{6});
+    mmser::appendFile<Log>(filename, std::vector<uint32_t>{});
+
+    // the old mapping still sees its prefix
+    REQUIRE(std::get<1>(old).size() == 3);
+    CHECK(std::get<1>(old)[2] == 3);
+
+    {
+        auto [output, storage] = mmser::loadFileMMap<Log>(filename);
+        CHECK(std::get<0>(output) == "events");
+        REQUIRE(std::get<1>(output).size() == 6);
+        for (size_t i{0}; i < 6; ++i) {
+            CHECK(std::get<1>(output)[i] == i + 1);
+        }
+        CHECK(std::filesystem::file_size(filename) == mmser::computeSaveSize(output));
+    }
+
+    { // a reader that mapped the file before an append, but reads the new size field
+        auto appended = Log{"events", {1, 2, 3, 4}};
+        auto buffer = std::vector<char>(mmser::computeSaveSize(appended));
+        mmser::save(buffer, appended);
+        auto mapped = std::span<char const>{buffer}.first(mmser::computeSaveSize(Log{"events", {1, 2, 3}}));
+        auto output = Log{};
+        CHECK_THROWS(mmser::loadMMap(mapped, output));
+        CHECK_THROWS(mmser::load(mapped, output));
+    }
+
+    // wrong element type, no trailing vector, or a vector inside another container
+    static_assert(mmser::appendable<Log, uint32_t>);
+    static_assert(mmser::appendable<std::tuple<int, std::tuple<char, mmser::vector<uint32_t>>>, uint32_t>);
+    static_assert(!mmser::appendable<Log, uint64_t>);
+    static_assert(!mmser::appendable<std::tuple<mmser::vector<uint32_t>, std::string>, uint32_t>);
+    static_assert(!mmser::appendable<std::tuple<std::string, mmser::packed_vector>, uint64_t>);
+    static_assert(!mmser::appendable<mmser::bitvector, uint64_t>);
+}
+#endif
+
+#ifdef MMSER_MMAP
+TEST_CASE("Tests mmser - delta save", "[mmser][save][delta]") {
+    using State = std::tuple<uint64_t, mmser::vector<uint32_t>, std::vector<int32_t>, mmser::bitvector>;
+    auto state = State{1, {}, {1, 2, 3}, mmser::bitvector(10'000)};
+    std::get<1>(state).resize(1'000'000, 5);
+    std::get<3>(state).buildIndex();
+
+    auto filename = std::filesystem::temp_directory_path() / std::filesystem::path{"unit_test_mmser_delta"};
+    std::filesystem::remove(filename);
+    auto readFile = [&]() {
+        auto file = std::ifstream{filename, std::ios::binary};
+        return std::vector<char>(std::istreambuf_iterator<char>{file}, {});
+    };
+    auto expected = [&]() {
+        auto buffer = std::vector<char>(mmser::computeSaveSize(state));
+        mmser::save(buffer, state);
+        return buffer;
+    };
+
+    // no file yet, complete save
+    CHECK(mmser::saveFileDelta(filename, state) == mmser::computeSaveSize(state));
+    CHECK(readFile() == expected());
+    CHECK(std::get<1>(state).tracking());
+
+    // unchanged
+    CHECK(mmser::saveFileDelta(filename, state) == 0);
+
+    // a few changes, the vector is not compared, only its dirty chunk is written
+    std::get<0>(state) = 2;
+    std::get<1>(state)[500'000] = 6;
+    std::get<2>(state)[1] = 7;
+    auto written = mmser::saveFileDelta(filename, state);
+    CHECK(written > 4096);
+    CHECK(written <= 3 * 4096);
+    CHECK(readFile() == expected());
+
+    // shrinking and growing back to the same size
+    std::get<1>(state).resize(999'999);
+    std::get<1>(state).push_back(8);
+    CHECK(mmser::saveFileDelta(filename, state) <= 4096 + 8);
+    CHECK(readFile() == expected());
+
+    // a different size changes the layout, the file is replaced
+    std::get<2>(state).push_back(9);
+    std::get<2>(state).push_back(10);
+    CHECK(mmser::saveFileDelta(filename, state) == mmser::computeSaveSize(state));
+    CHECK(readFile() == expected());
+
+    // changes to a mapped state, copy-on-write pages are written back
+    {
+        auto [mapped, storage] = mmser::loadFileMMap<State>(filename);
+        std::get<1>(mapped)[10] = 11;
+        std::get<3>(mapped).set(3, true);
+        CHECK(std::get<1>(mapped).owningBuffer.empty());
+        CHECK(mmser::saveFileDelta(filename, mapped) <= 2 * 4096);
+        std::get<1>(state)[10] = 11;
+        std::get<3>(state).set(3, true);
+        CHECK(readFile() == expected());
+    }
+
+    { // tracked changes belong to the position of a vector, not to its data
+        using Buffers = std::tuple<mmser::vector<uint32_t>, mmser::vector<uint32_t>>;
+        auto buffers = Buffers{mmser::vector<uint32_t>(10'000, 1), mmser::vector<uint32_t>(10'000, 2)};
+        auto buffersFilename = std::filesystem::temp_directory_path() / std::filesystem::path{"unit_test_mmser_delta_swap"};
+        mmser::saveFileDelta(buffersFilename, buffers);
+        auto check = [&](Buffers const& expected) {
+            auto [loaded, storage] = mmser::loadFileMMap<Buffers>(buffersFilename);
+            CHECK(std::ranges::equal(std::get<0>(loaded).view, std::get<0>(expected).view));
+            CHECK(std::ranges::equal(std::get<1>(loaded).view, std::get<1>(expected).view));
+        };
+
+        std::get<0>(buffers)[0] = 3;
+        std::swap(std::get<0>(buffers), std::get<1>(buffers));
+        CHECK(mmser::saveFileDelta(buffersFilename, buffers) == 2 * 40'000);
+        check(buffers);
+
+        // also for vectors that were loaded via mmap and are not written to
+        auto [mapped, storage] = mmser::loadFileMMap<Buffers>(buffersFilename);
+        std::swap(std::get<0>(mapped), std::get<1>(mapped));
+        mmser::saveFileDelta(buffersFilename, mapped);
+        std::swap(std::get<0>(buffers), std::get<1>(buffers));
+        check(buffers);
+    }
+}
+#endif